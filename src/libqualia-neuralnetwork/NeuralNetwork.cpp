@@ -8,6 +8,7 @@
 #include <cmath>
 #include <array>
 #include <type_traits>
+#include <limits>
 
 extern "C" {
 #ifdef WITH_CMSIS_NN
@@ -72,9 +73,7 @@ float round_with_mode(float v, round_mode_t round_mode) {
 }
 
 
-void neuralNetworkRun(const float input[], output_t output) {
-	static input_t inputs;
-
+static void quantizeInput(const float input[], input_t inputs) {
 	MODEL_INPUT_NUMBER_T *input_flat = (MODEL_INPUT_NUMBER_T*)inputs;
 
 	// Prepare inputs
@@ -91,16 +90,53 @@ void neuralNetworkRun(const float input[], output_t output) {
 			input_flat[i] = input[i];
 		}
 	}
+}
+
+void neuralNetworkRun(const float input[], output_t output) {
+	static input_t inputs;
+
+	// Prepare inputs
+	quantizeInput(input, inputs);
 
 	// Run inference
 	cnn(inputs, output);
 }
 
-struct NNResult neuralNetworkInfer(const float input[]) {
-	static output_t outputs;
+void neuralNetworkRunBatch(const float input[][MODEL_INPUT_DIMS], output_t outputs[], size_t n) {
+	static input_t inputs[MODEL_MAX_BATCH];
+
+	for (size_t start = 0; start < n; start += MODEL_MAX_BATCH) {
+		size_t batch = std::min(n - start, (size_t)MODEL_MAX_BATCH);
 
-	neuralNetworkRun(input, outputs);
+		// Prepare inputs of the mini-batch
+		for (size_t i = 0; i < batch; i++) {
+			quantizeInput(input[start + i], inputs[i]);
+		}
+
+		// Run inference, each layer processes the whole mini-batch
+		cnn_batch(inputs, &outputs[start], batch);
+	}
+}
 
+void neuralNetworkRun_r(struct NNContext *ctx, const float input[], output_t output) {
+	quantizeInput(input, ctx->inputs[0]);
+
+	cnn_r(&ctx->cnn, ctx->inputs[0], output);
+}
+
+void neuralNetworkRunBatch_r(struct NNContext *ctx, const float input[][MODEL_INPUT_DIMS], output_t outputs[], size_t n) {
+	for (size_t start = 0; start < n; start += MODEL_MAX_BATCH) {
+		size_t batch = std::min(n - start, (size_t)MODEL_MAX_BATCH);
+
+		for (size_t i = 0; i < batch; i++) {
+			quantizeInput(input[start + i], ctx->inputs[i]);
+		}
+
+		cnn_batch_r(&ctx->cnn, ctx->inputs, &outputs[start], batch);
+	}
+}
+
+static struct NNResult classify(const output_t outputs) {
 	// Get output class
 	unsigned int label = 0;
 	float max_val = outputs[0];
@@ -116,4 +152,103 @@ struct NNResult neuralNetworkInfer(const float input[]) {
 	return {inference_count, label, max_val};
 }
 
+static struct {
+	MODEL_INPUT_LONG_NUMBER_T threshold = -1; // In the number type of the model input, negative if disabled
+	bool valid = false; // reference and result are from the last computed inference
+	input_t inputs;
+	input_t reference;
+	struct NNResult result;
+	struct NNGateStats stats;
+} gate;
+
+void neuralNetworkSetGate(float threshold) {
+	if (!(threshold >= 0)) { // Negative or NaN
+		gate.threshold = -1;
+	} else if constexpr(std::is_integral_v<MODEL_INPUT_NUMBER_T>) {
+		// Clamped before the conversion which is undefined for values out of range
+		constexpr MODEL_INPUT_LONG_NUMBER_T max = std::numeric_limits<MODEL_INPUT_LONG_NUMBER_T>::max();
+		float scaled = threshold * (1<<MODEL_INPUT_SCALE_FACTOR);
+		gate.threshold = scaled < (float)max ? (MODEL_INPUT_LONG_NUMBER_T)scaled : max;
+	} else {
+		gate.threshold = threshold;
+	}
+	gate.valid = false;
+	gate.stats = {};
+}
+
+struct NNGateStats neuralNetworkGateStats(void) {
+	return gate.stats;
+}
+
+// Stops at the first value differing by more than the threshold, idle inputs are compared entirely
+static bool inputChanged(const input_t inputs, const input_t reference) {
+	const MODEL_INPUT_NUMBER_T *inputs_flat = (const MODEL_INPUT_NUMBER_T*)inputs;
+	const MODEL_INPUT_NUMBER_T *reference_flat = (const MODEL_INPUT_NUMBER_T*)reference;
+
+	for (size_t i = 0; i < MODEL_INPUT_DIMS; i++) {
+		MODEL_INPUT_LONG_NUMBER_T diff = (MODEL_INPUT_LONG_NUMBER_T)inputs_flat[i] - reference_flat[i];
+
+		if (diff > gate.threshold || -diff > gate.threshold) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+struct NNResult neuralNetworkInfer(const float input[]) {
+	static output_t outputs;
+
+	if (gate.threshold < 0) {
+		neuralNetworkRun(input, outputs);
+
+		return classify(outputs);
+	}
+
+	quantizeInput(input, gate.inputs);
+
+	if (gate.valid && !inputChanged(gate.inputs, gate.reference)) {
+		gate.stats.hits++;
+		inference_count++;
+
+		return {inference_count, gate.result.label, gate.result.dist};
+	}
+
+	// Compared against the input of the computed inference rather than the previous one so that slow drifts still trigger
+	gate.stats.misses++;
+	memcpy(gate.reference, gate.inputs, sizeof(input_t));
+	cnn(gate.reference, outputs);
+	gate.result = classify(outputs);
+	gate.valid = true;
+
+	return gate.result;
+}
+
+static struct {
+	bool done = false;
+	input_t inputs;
+	output_t outputs;
+	struct NNResult result; // Classified once when the inference completes
+} step;
+
+void neuralNetworkBegin(const float input[]) {
+	quantizeInput(input, step.inputs);
+
+	cnn_begin(step.inputs, step.outputs);
+	step.done = false;
+}
+
+int neuralNetworkStep(unsigned long macs) {
+	if (!step.done && cnn_step(macs)) {
+		step.result = classify(step.outputs);
+		step.done = true;
+	}
+
+	return step.done;
+}
+
+struct NNResult neuralNetworkResult(void) {
+	return step.result;
+}
+
 }
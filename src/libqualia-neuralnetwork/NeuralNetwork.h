@@ -17,12 +17,37 @@ struct NNResult {
 	float dist;
 };
 
+// Inferences of neuralNetworkInfer() skipped by the change gate (hits) or computed (misses)
+struct NNGateStats {
+	unsigned long hits;
+	unsigned long misses;
+};
+
+// Buffers of a reentrant inference, each thread running the model concurrently needs its own context
+struct NNContext {
+	input_t inputs[MODEL_MAX_BATCH]; // Inputs converted to the number type of the model
+	cnn_ctx_t cnn;
+};
+
 extern unsigned int inference_count;
 float *serialBufToFloats(char buf[], size_t buflen);
 void stringToFloatArray(float floats[], size_t floatslen, char string[], size_t stringlen);
 float round_with_mode(float v, round_mode_t round_mode);
 struct NNResult neuralNetworkInfer(const float input[]);
 void neuralNetworkRun(const float input[], output_t output);
+void neuralNetworkRunBatch(const float input[][MODEL_INPUT_DIMS], output_t outputs[], size_t n);
+void neuralNetworkRun_r(struct NNContext *ctx, const float input[], output_t output);
+void neuralNetworkRunBatch_r(struct NNContext *ctx, const float input[][MODEL_INPUT_DIMS], output_t outputs[], size_t n);
+/* Inference split in steps of bounded multiply-accumulate operations, neuralNetworkStep() returns non-zero once it is done.
+ * neuralNetworkResult() returns the result of the last completed inference. */
+void neuralNetworkBegin(const float input[]);
+int neuralNetworkStep(unsigned long macs);
+struct NNResult neuralNetworkResult(void);
+/* Change gate of neuralNetworkInfer(), disabled by default: while no value of the quantized input differs by more than threshold
+ * (in input units) from the input of the last computed inference, its result is returned again without running the model.
+ * A negative threshold disables the gate. Setting the threshold clears the cached result and the counters. */
+void neuralNetworkSetGate(float threshold);
+struct NNGateStats neuralNetworkGateStats(void);
 
 #ifdef __cplusplus
 }
@@ -64,6 +89,23 @@ public:
     return output;
   }
 
+  void updateMetrics(
+    const std::array<std::remove_all_extents<output_t>::type, MODEL_OUTPUT_SAMPLES> &preds,
+    const std::array<float, MODEL_OUTPUT_SAMPLES> &targets) {
+    // De-quantize predictions to match targets for metrics computation
+    std::array<metric_return_t, MODEL_OUTPUT_SAMPLES> deqpreds{};
+    std::transform(preds.begin(),
+                   preds.end(),
+                   deqpreds.begin(),
+                   [](MODEL_OUTPUT_NUMBER_T v) {
+                    return static_cast<metric_return_t>(v) / (1 << MODEL_OUTPUT_SCALE_FACTOR);
+                   });
+
+    for (auto &metric: this->metrics) {
+      metric->update(deqpreds, targets);
+    }
+  }
+
   NNResult classify(const std::array<float, MODEL_INPUT_DIMS> input) {
     auto preds = this->run(input);
     auto e = std::max_element(preds.begin(), preds.end());
@@ -79,22 +121,32 @@ public:
     const std::array<float, MODEL_OUTPUT_SAMPLES> targets) {
     auto preds = this->run(input);
 
-    // De-quantize predictions to match targets for metrics computation
-    std::array<metric_return_t, MODEL_OUTPUT_SAMPLES> deqpreds{};
-    std::transform(preds.begin(),
-                   preds.end(),
-                   deqpreds.begin(),
-                   [](MODEL_OUTPUT_NUMBER_T v) {
-                    return static_cast<metric_return_t>(v) / (1 << MODEL_OUTPUT_SCALE_FACTOR);
-                   });
-
-    for (auto &metric: this->metrics) {
-      metric->update(deqpreds, targets);
-    }
+    this->updateMetrics(preds, targets);
 
     return preds;
   }
 
+  // Evaluate n samples with cnn_batch(), layers process mini-batches of up to MODEL_MAX_BATCH samples
+  void evaluate_batch(
+    const std::array<float, MODEL_INPUT_DIMS> inputs[],
+    const std::array<float, MODEL_OUTPUT_SAMPLES> targets[],
+    size_t n) {
+    static_assert(sizeof(std::array<float, MODEL_INPUT_DIMS>) == sizeof(float[MODEL_INPUT_DIMS]));
+    static output_t c_outputs[MODEL_MAX_BATCH];
+    std::array<std::remove_all_extents<output_t>::type, MODEL_OUTPUT_SAMPLES> preds;
+
+    for (size_t start = 0; start < n; start += MODEL_MAX_BATCH) {
+      size_t batch = std::min(n - start, (size_t)MODEL_MAX_BATCH);
+
+      neuralNetworkRunBatch(reinterpret_cast<const float (*)[MODEL_INPUT_DIMS]>(&inputs[start]), c_outputs, batch);
+
+      for (size_t i = 0; i < batch; i++) {
+        std::copy(std::begin(c_outputs[i]), std::end(c_outputs[i]), preds.begin());
+        this->updateMetrics(preds, targets[start + i]);
+      }
+    }
+  }
+
   std::array<float, NMetrics> getMetricsResult() {
     std::array<metric_return_t, NMetrics> metrics_result{};
 
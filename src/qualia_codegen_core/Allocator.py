@@ -2,14 +2,27 @@
 
 from __future__ import annotations
 
+import itertools
 import logging
+import math
 from dataclasses import dataclass
 from typing import TYPE_CHECKING
 
-from .graph.layers import TFlattenLayer
+from .graph.layers import (
+    TActivationLayer,
+    TAddLayer,
+    TBatchNormalization1DLayer,
+    TBatchNormalization2DLayer,
+    TConcatenateLayer,
+    TFlattenLayer,
+    TSampleNormLayer,
+    TSliceLayer,
+)
 
 if TYPE_CHECKING:
     import sys
+    from collections.abc import Collection
+
     if sys.version_info >= (3, 11):
         from typing import Self
     else:
@@ -21,21 +34,96 @@ if TYPE_CHECKING:
 logger = logging.getLogger(__name__)
 
 class Allocator:
+    # Offsets of activations in the arena are multiples of this number of bytes, enough for any number type of the activations
+    ARENA_ALIGNMENT = 4
+    # Layers computing each output element only from the elements at the same position of their inputs (or of the same channel
+    # for SampleNorm) after reading them, so their output can be written over one of their inputs
+    IN_PLACE_LAYERS = (TActivationLayer, TAddLayer, TBatchNormalization1DLayer, TBatchNormalization2DLayer, TSampleNormLayer)
+
     @dataclass
     class AllocInfo:
         node: LayerNode
         input_ai: list[Self]
         keep_until: int
-        overwrite_input: bool
+        shared: Self | None  # Layer whose memory also holds the output: input overwritten or viewed, or input of a concatenation
+        offset: int = 0  # Byte offset of the output in this memory
+        view: bool = False  # Output only aliases the memory of the inputs, nothing is computed
+
+    def __init__(self,
+                 max_batch: int = 1,
+                 concurrent_branches: bool = False,  # noqa: FBT001, FBT002
+                 persistent: Collection[LayerNode] = (),
+                 arena: bool = True) -> None:  # noqa: FBT001, FBT002
+        """Construct the allocator.
+
+        :param max_batch: Maximum number of samples of a mini-batch, each activation of a pool is allocated for this number of
+            samples
+        :param concurrent_branches: Only reuse a pool whose layers and readers all are ancestors of the new layer, so that
+            independent branches never wait on each other for a pool, see :meth:`task_graph`
+        :param persistent: Layers whose output is kept from one inference to the next, their pool is never reused
+        :param arena: Place the pools at offsets of a single arena planned from the size and lifetime of the activations when it
+            is smaller than the sum of the pools, see :meth:`plan_arena`
+        """
+        super().__init__()
+        self.max_batch = max_batch
+        self.concurrent_branches = concurrent_branches
+        self.persistent = set(persistent)
+        self.arena = arena
+
+    @staticmethod
+    def ancestors(modelgraph: ModelGraph) -> dict[LayerNode, set[LayerNode]]:
+        """Layers each layer transitively depends on."""
+        ancestors: dict[LayerNode, set[LayerNode]] = {}
+        for node in modelgraph.nodes:
+            ancestors[node] = set()
+            for innode in node.innodes:
+                ancestors[node] |= {innode, *ancestors[innode]}
+        return ancestors
+
+    @staticmethod
+    def scratch_pools(modelgraph: ModelGraph,
+                      nodes: Collection[LayerNode],
+                      concurrent_branches: bool = False) -> list[list[LayerNode]]:  # noqa: FBT001, FBT002
+        """Group the layers using scratch buffers so that the buffers of the layers of a group overlap.
+
+        Scratch buffers only hold temporaries of a single call of their layer. Layers that run one after the other can share
+        them, so all of them are in a single group. With concurrent branches, a layer only joins a group whose layers are all its
+        ancestors.
+        """
+        ancestors = Allocator.ancestors(modelgraph)
+        pools: list[list[LayerNode]] = []
+        for node in (node for node in modelgraph.nodes if node in nodes):
+            pool = next((p for p in pools if not concurrent_branches or set(p) <= ancestors[node]), None)
+            if pool is None:
+                pools.append([node])
+            else:
+                pool.append(node)
+        return pools
+
+    def reusable(self,
+                 pool: list[Allocator.AllocInfo],
+                 alloc_info: Allocator.AllocInfo,
+                 ancestors: dict[LayerNode, set[LayerNode]]) -> bool:
+        """Check whether a free pool can hold the output of a layer.
 
-    def __call__(self, modelgraph: ModelGraph) -> dict[str, list[list[LayerNode]] | dict[LayerNode, int]] | None:
+        Pools holding a persistent output are never reused. With concurrent branches, the layers of the pool and their readers
+        must all have finished before the layer starts.
+        """
+        if any(a.node in self.persistent for a in pool):
+            return False
+        if not self.concurrent_branches:
+            return True
+        done = {alloc_info.node, *ancestors[alloc_info.node]}
+        return all({a.node, *a.node.outnodes} <= done for a in pool)
+
+    def __call__(self, modelgraph: ModelGraph) -> dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int] | None:
         pools: list[list[Allocator.AllocInfo]] = [[]]
 
         alloc_info_list: list[Allocator.AllocInfo] = []
+        ancestors = self.ancestors(modelgraph)
+        concatenations = self.concatenations(modelgraph)
 
         for node in modelgraph.nodes[:-1]:  # No allocation for input and last layer, allocated by caller
-            overwrite_input = isinstance(node.layer, TFlattenLayer)
-
             # First layer is assumed to take input from outside model
             inlayersi = [alloc_info_list[modelgraph.nodes.index(innode)] for innode in node.innodes]
 
@@ -45,21 +133,23 @@ class Allocator:
                 logger.warning('Found intermediate node with no output node: %s', node.layer.name)
             keep_until = max(outlayersi) if len(outlayersi) > 0 else -1
 
-            alloc_info_list.append(Allocator.AllocInfo(
+            alloc_info = Allocator.AllocInfo(
                 node,
                 inlayersi,
                 keep_until,
-                overwrite_input))
+                None)
+            self.share(modelgraph, alloc_info, alloc_info_list, concatenations, ancestors)
+            alloc_info_list.append(alloc_info)
 
         for i, a in enumerate(alloc_info_list[1:]):  # Skip InputLayer
             if i == 0:  # first layer after input layer, assume it takes input from outside model
                 pools[0].append(a)
-            elif a.overwrite_input:
-                if len(a.input_ai) != 1:
+            elif a.shared is not None:
+                if isinstance(a.node.layer, TFlattenLayer) and len(a.input_ai) != 1:
                     logger.error('Need exactly one inpurt layer when overwriting input')
                     return None
                 # Find which pool contains input
-                inp = [p for p in pools if a.input_ai[0] in p]
+                inp = [p for p in pools if a.shared in p]
                 if len(inp) != 1:
                     logger.error('Input layer must be allocated in exactly one pool')
                     return None
@@ -68,14 +158,322 @@ class Allocator:
                 # Find pools not containing inputs
                 ap = [p for p in pools for iai in a.input_ai if iai not in p]
                 # Find pools that can be overwritten
-                op = [p for p in ap if p[-1].keep_until <= i]
+                op = [p for p in ap if p[-1].keep_until <= i and self.reusable(p, a, ancestors)]
 
                 if len(op) < 1:  # no free pool, allocate new one
                     pools.append([a])
                 else:  # Add to first usable pool — maybe possible to optimize allocation size
                     op[0].append(a)
 
-        return {
+        allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int] = {
             'pools': [[a.node for a in p] for p in pools],
             'index': {a.node: (i + 1) for i, p in enumerate(pools) for a in p},
+            'views': {a.node: a.offset for a in alloc_info_list if a.view},
+            'placement': {a.node: a.offset for a in alloc_info_list if a.offset},
+            'max_batch': self.max_batch,
+        }
+        if self.arena:
+            allocation.update(self.plan_arena(modelgraph, alloc_info_list[1:], pools, ancestors))
+        return allocation
+
+    def share(self,
+              modelgraph: ModelGraph,
+              alloc_info: Allocator.AllocInfo,
+              alloc_info_list: list[Allocator.AllocInfo],
+              concatenations: dict[LayerNode, tuple[LayerNode, int]],
+              ancestors: dict[LayerNode, set[LayerNode]]) -> None:
+        """Set the memory the output of a layer shares with other layers, its offset in it and whether it is only a view."""
+        node = alloc_info.node
+        if node in concatenations:
+            first, alloc_info.offset = concatenations[node]
+            if first is not node:
+                alloc_info.shared = alloc_info_list[modelgraph.nodes.index(first)]
+            alloc_info.view = isinstance(node.layer, TConcatenateLayer)
+            return
+
+        alloc_info.shared = self.overwrite_input(modelgraph, node, alloc_info.input_ai, ancestors)
+        if alloc_info.shared is None:
+            return
+        alloc_info.offset = alloc_info.shared.offset
+        offset = self.view_offset(node)
+        if offset is not None and self.shareable(modelgraph, node, alloc_info.shared, ancestors):
+            alloc_info.offset += offset
+            alloc_info.view = True
+            logger.info('%s is a view of %s at byte %d', node.layer.name, alloc_info.shared.node.layer.name, offset)
+
+    def overwrite_input(self,
+                        modelgraph: ModelGraph,
+                        node: LayerNode,
+                        input_ai: list[Allocator.AllocInfo],
+                        ancestors: dict[LayerNode, set[LayerNode]]) -> Allocator.AllocInfo | None:
+        """Select the input a layer writes its output over, if any.
+
+        Flatten only reinterprets its input so it always shares its memory. A Slice of a contiguous part of its input shares it
+        when the input can be shared, see :meth:`view_offset`. A layer of :attr:`IN_PLACE_LAYERS` may overwrite an input of the
+        same size that can be shared, unless it is a part of a larger memory that would be kept for the layer.
+        """
+        if isinstance(node.layer, TFlattenLayer):
+            return input_ai[0] if input_ai else None
+        if isinstance(node.layer, TSliceLayer):
+            shared = input_ai[0] if len(input_ai) == 1 and self.view_offset(node) is not None else None
+            return shared if shared is not None and self.shareable(modelgraph, node, shared, ancestors) else None
+        if not isinstance(node.layer, Allocator.IN_PLACE_LAYERS):
+            return None
+
+        for a in input_ai:
+            if (self.output_size(a.node) == self.output_size(node)
+                and self.covers(a)
+                and self.shareable(modelgraph, node, a, ancestors)):
+                logger.info('%s computed in place of %s', node.layer.name, a.node.layer.name)
+                return a
+        return None
+
+    def covers(self, alloc_info: Allocator.AllocInfo) -> bool:
+        """Check whether the output of a layer covers all the memory it shares with other layers."""
+        if alloc_info.shared is None or isinstance(alloc_info.node.layer, TConcatenateLayer):
+            return True
+        return (not (alloc_info.view and isinstance(alloc_info.node.layer, TSliceLayer))
+                and alloc_info.offset == alloc_info.shared.offset
+                and self.covers(alloc_info.shared))
+
+    def shareable(self,
+                  modelgraph: ModelGraph,
+                  node: LayerNode,
+                  a: Allocator.AllocInfo,
+                  ancestors: dict[LayerNode, set[LayerNode]]) -> bool:
+        """Check whether a layer may use the memory of one of its inputs.
+
+        The input must be computed by the model with the same number type, neither the input nor the layer are persistent and no
+        layer after it reads the input. With concurrent branches, the other readers of the input must also be ancestors of the
+        layer.
+        """
+        return (a.node is not modelgraph.nodes[0]
+                and a.node not in self.persistent
+                and node not in self.persistent
+                and a.node.q.number_type == node.q.number_type
+                and a.node.q.width == node.q.width
+                and a.keep_until == modelgraph.nodes.index(node)
+                and (not self.concurrent_branches or set(a.node.outnodes) - {node} <= ancestors[node]))
+
+    def concatenations(self, modelgraph: ModelGraph) -> dict[LayerNode, tuple[LayerNode, int]]:
+        """Concatenations whose inputs are computed directly in their output.
+
+        With a single sample per mini-batch, each input of a concatenation is a contiguous part of its output. The layer
+        computing an input writes its output there when the concatenation is its only reader, with the same number type, and
+        neither of them is persistent. The concatenation is then only a view of the outputs of its inputs.
+
+        :return: Input computed first of each of these concatenations, whose memory they share, and byte offset in this memory of
+            the outputs of the concatenation and each of its inputs
+        """
+        concatenations: dict[LayerNode, tuple[LayerNode, int]] = {}
+        if self.max_batch > 1:
+            return concatenations
+
+        for node in modelgraph.nodes[1:-1]:
+            if (not isinstance(node.layer, TConcatenateLayer)
+                or node in self.persistent
+                or len(set(node.innodes)) != len(node.innodes)
+                or any(innode is modelgraph.nodes[0]
+                       or innode in self.persistent
+                       or innode in concatenations
+                       or innode.outnodes != [node]
+                       or innode.q.number_type != node.q.number_type
+                       or innode.q.width != node.q.width for innode in node.innodes)):
+                continue
+            sizes = [self.output_size(innode) for innode in node.innodes]
+            if sum(sizes) != self.output_size(node):
+                continue
+
+            first = min(node.innodes, key=modelgraph.nodes.index)
+            concatenations.update({innode: (first, offset)
+                                   for innode, offset in zip(node.innodes, itertools.accumulate([0, *sizes[:-1]]))})
+            concatenations[node] = (first, 0)
+            logger.info('%s computed in the output of %s',
+                        ', '.join(innode.layer.name for innode in node.innodes), node.layer.name)
+        return concatenations
+
+    def view_offset(self, node: LayerNode) -> int | None:
+        """Byte offset in its input of the output of a layer only reading a contiguous part of its input, ``None`` otherwise.
+
+        Flatten keeps the whole input. A Slice with a step of 1 keeps a contiguous part when it selects a single index of the
+        dimensions before the last partial one, and whole dimensions after it. Samples of a mini-batch would not be contiguous
+        so slices are only views for a single sample.
+        """
+        if isinstance(node.layer, TFlattenLayer):
+            return 0
+        if not isinstance(node.layer, TSliceLayer) or self.max_batch > 1:
+            return None
+
+        dims = node.input_shape[0][1:]
+        slices = [*node.layer.slices[1:], *[slice(None)] * len(dims)][:len(dims)]
+        ranges = [range(*s.indices(dim)) for s, dim in zip(slices, dims)]
+        partial = [i for i, (r, dim) in enumerate(zip(ranges, dims)) if r != range(dim)]
+        last = partial[-1] if partial else 0
+        if (any(len(r) != 1 for r in ranges[:last])
+            or not ranges[last]
+            or (len(ranges[last]) > 1 and ranges[last].step != 1)):
+            return None
+        return sum(r.start * math.prod(dims[i + 1:]) for i, r in enumerate(ranges)) * (node.q.width or 0) // 8
+
+    def output_size(self, node: LayerNode) -> int:
+        """Bytes of the ``_output_type`` of a layer for all the samples of a mini-batch."""
+        if isinstance(node.layer, TActivationLayer):  # Output is always float
+            return node.input_shape[0][-1] * 4 * self.max_batch
+        return math.prod(node.output_shape[0][1:]) * (node.q.width or 0) // 8 * self.max_batch
+
+    def conflict(self,
+                 a: Allocator.AllocInfo,
+                 b: Allocator.AllocInfo,
+                 order: dict[LayerNode, int],
+                 ancestors: dict[LayerNode, set[LayerNode]]) -> bool:
+        """Check whether the outputs of two layers may be live at the same time.
+
+        With concurrent branches, the layer computed first and all its readers must be ancestors of the other layer.
+        """
+        if a.node in self.persistent or b.node in self.persistent:
+            return True
+        first, second = (a, b) if order[a.node] < order[b.node] else (b, a)
+        if first.keep_until >= order[second.node]:
+            return True
+        return self.concurrent_branches and not {first.node, *first.node.outnodes} <= ancestors[second.node]
+
+    @staticmethod
+    def best_fit(sizes: list[int], conflicts: list[set[int]], placement_order: list[int]) -> list[int]:
+        """Place each pool in turn in the smallest gap between the pools it conflicts with, or after them."""
+        offsets = [0] * len(sizes)
+        placed: list[int] = []
+        for i in placement_order:
+            best: tuple[int, int] | None = None  # gap, offset
+            end = 0
+            for j in sorted((j for j in placed if j in conflicts[i]), key=lambda j: offsets[j]):
+                gap = offsets[j] - end
+                if gap >= sizes[i] and (best is None or gap < best[0]):
+                    best = (gap, end)
+                end = max(end, offsets[j] + sizes[j])
+            offsets[i] = best[1] if best is not None else end
+            placed.append(i)
+        return offsets
+
+    def plan_arena(self,
+                   modelgraph: ModelGraph,
+                   alloc_info_list: list[Allocator.AllocInfo],
+                   pools: list[list[Allocator.AllocInfo]],
+                   ancestors: dict[LayerNode, set[LayerNode]]) -> dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int]:
+        """Assign an offset in a single arena to the activations of each pool.
+
+        Layers sharing a pool because they use the memory of another layer, see :meth:`share`, keep sharing it, otherwise each
+        output has its own pool. Pools are placed one after the other at the offset of the smallest gap between the pools already
+        placed they conflict with (best fit), or after all of them, from the largest to the smallest one or in execution order,
+        whichever gives the smallest arena. The arena is only used when it is smaller than the sum of the greedy pools.
+
+        :return: ``pools``, ``index``, ``offsets`` and ``sizes`` in bytes of each layer output, ``arena`` size and its
+            ``lower_bound``, or an empty dict to keep the greedy pools
+        """
+        order = {node: i for i, node in enumerate(modelgraph.nodes)}
+        buffers: list[list[Allocator.AllocInfo]] = []
+        for a in alloc_info_list:
+            shared = [b for b in buffers if a.shared is not None and a.shared in b]
+            if shared:
+                shared[0].append(a)
+            else:
+                buffers.append([a])
+
+        def align(size: int) -> int:
+            return -(-size // Allocator.ARENA_ALIGNMENT) * Allocator.ARENA_ALIGNMENT
+
+        sizes = [align(max(self.output_size(a.node) for a in b)) for b in buffers]
+        conflicts = [{j for j, other in enumerate(buffers)
+                      if j != i and any(self.conflict(a, c, order, ancestors) for a in b for c in other)}
+                     for i, b in enumerate(buffers)]
+
+        # Largest pools first usually packs best, execution order is better for chains of growing activations
+        placements = [self.best_fit(sizes, conflicts, sorted(range(len(buffers)), key=key))
+                      for key in (lambda i: (-sizes[i], order[buffers[i][0].node]), lambda i: order[buffers[i][0].node])]
+        offsets = min(placements, key=lambda offsets: max((o + size for o, size in zip(offsets, sizes)), default=0))
+        arena = max((offset + size for offset, size in zip(offsets, sizes)), default=0)
+        pools_size = sum(align(max(self.output_size(a.node) for a in p)) for p in pools if p)
+        # Largest sum of the activations live during each layer, persistent ones are always live
+        lower_bound = max((sum(size for b, size in zip(buffers, sizes)
+                               if any(a.node in self.persistent or order[a.node] <= step <= max(a.keep_until, order[a.node])
+                                      for a in b))
+                           for step in range(len(modelgraph.nodes))), default=0)
+        logger.info('Activations: arena of %d bytes, lower bound %d bytes, pools %d bytes', arena, lower_bound, pools_size)
+
+        if arena >= pools_size:
+            logger.info('Arena is not smaller than pools, keeping pools')
+            return {}
+        return {
+            'pools': [[a.node for a in b] for b in buffers],
+            'index': {a.node: (i + 1) for i, b in enumerate(buffers) for a in b},
+            'offsets': {a.node: offset for b, offset in zip(buffers, offsets) for a in b},
+            'sizes': {a.node: self.output_size(a.node) for b in buffers for a in b},
+            'arena': arena,
+            'lower_bound': lower_bound,
+        }
+
+    def overwritten(self,
+                    order: dict[LayerNode, int],
+                    allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int],
+                    ) -> dict[LayerNode, list[LayerNode]] | None:
+        """Layers computed before each layer whose output shares its memory: same pool or overlapping offsets of the arena."""
+        pools = allocation['pools']
+        offsets = allocation.get('offsets')
+        sizes = allocation.get('sizes')
+        placement = allocation.get('placement', {})
+        if not isinstance(pools, list) or not isinstance(placement, dict):
+            return None
+        if not isinstance(offsets, dict) or not isinstance(sizes, dict):
+            return {node: pool[:j] for pool in pools for j, node in enumerate(pool)}
+
+        ranges = {node: (offset + placement.get(node, 0), offset + placement.get(node, 0) + sizes[node])
+                  for node, offset in offsets.items()}
+        return {node: [other for other, (other_start, other_end) in ranges.items()
+                       if order[other] < order[node] and other_start < end and start < other_end]
+                for node, (start, end) in ranges.items()}
+
+    def task_graph(self,
+                   modelgraph: ModelGraph,
+                   allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int]) -> dict[str, list[int]] | None:
+        """Build the graph of layers that can run concurrently while respecting the lifetime of pool activations.
+
+        Task i is the layer modelgraph.nodes[i + 1]. A layer depends on its input layers and, since it overwrites its pool, on
+        the previous layers allocated in the same memory and all their readers. Dependencies always go from a layer to one that
+        comes after it in the sequential order so the graph is acyclic.
+
+        :param modelgraph: Model graph the allocation was computed for
+        :param allocation: Result of :meth:`__call__`
+        :return: Number of predecessors ``deps`` of each task, successors of task i ``successors[first[i]:first[i + 1]]``, or
+            ``None`` if there are no independent layers
+        """
+        nodes = modelgraph.nodes
+        if not any(len(node.outnodes) > 1 for node in nodes):
+            logger.info('No independent layers, model runs sequentially')
+            return None
+
+        order = {node: i for i, node in enumerate(nodes)}
+        predecessors: dict[LayerNode, set[LayerNode]] = {node: {innode for innode in node.innodes if order[innode] > 0}
+                                                         for node in nodes[1:]}
+
+        overwritten = self.overwritten(order, allocation)
+        if overwritten is None:
+            logger.error('Invalid allocation')
+            return None
+        for node, previous_nodes in overwritten.items():
+            for previous in previous_nodes:
+                predecessors[node].update(reader for reader in [previous, *previous.outnodes]
+                                          if reader is not node and order[reader] < order[node])
+
+        successors: list[list[int]] = [[] for _ in nodes[1:]]
+        for node, preds in predecessors.items():
+            for pred in preds:
+                successors[order[pred] - 1].append(order[node] - 1)
+
+        first = [0]
+        for s in successors:
+            first.append(first[-1] + len(s))
+
+        return {
+            'deps': [len(predecessors[node]) for node in nodes[1:]],
+            'first': first,
+            'successors': [t for s in successors for t in sorted(s)],
         }
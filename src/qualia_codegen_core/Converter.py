@@ -3,24 +3,27 @@
 from __future__ import annotations
 
 import logging
+import math
 import sys
 from importlib.resources import files
 from pathlib import Path
 from typing import TYPE_CHECKING, Any, ClassVar, NamedTuple, cast
 
 import jinja2
+import numpy as np
 
 from .Allocator import Allocator
 from .DataConverter import DataConverter
 from .graph import layers
+from .graph.LayerNode import LayerNode
 from .graph.layers.TActivationLayer import TActivation, TActivationLayer
+from .graph.ModelGraph import ModelGraph
+from .KernelSelector import KernelSelector
 from .Quantizer import Quantizer
 from .Validator import Validator
 
 if TYPE_CHECKING:
-    from .graph.LayerNode import LayerNode
     from .graph.layers.TBaseLayer import TBaseLayer
-    from .graph.ModelGraph import ModelGraph
 
 logger = logging.getLogger(__name__)
 
@@ -57,18 +60,72 @@ class Converter:
         layers.TConcatenateLayer: 'concatenate',
         layers.TSampleNormLayer: 'samplenorm',
         layers.TSliceLayer: 'slice',
+
+        # Fused layers built by the Converter
+        layers.TSeparableConv1DLayer: 'separableconv1d',
+        layers.TSeparableConv2DLayer: 'separableconv2d',
     }
 
     TEMPLATE_PATH = files('qualia_codegen_core.assets')
 
-    def __init__(self,
+    def __init__(self,  # noqa: PLR0913, PLR0917 One parameter per code generation option
                  output_path: Path | None = None,
-                 dump_featuremaps: bool = False) -> None:  # noqa: FBT001, FBT002
+                 dump_featuremaps: bool = False,  # noqa: FBT001, FBT002
+                 conv_engine: str = 'direct',
+                 conv_scratch_size: int = 8192,
+                 fuse_separable_conv: bool = False,  # noqa: FBT001, FBT002
+                 max_batch: int = 1,
+                 branch_parallelism: bool = False,  # noqa: FBT001, FBT002
+                 pipeline_stages: int = 1,
+                 stream_hop: int = 0,
+                 partial_update: bool = False,  # noqa: FBT001, FBT002
+                 variable_length: bool = False,  # noqa: FBT001, FBT002
+                 split_layer: str | None = None,
+                 activations_arena: bool = True) -> None:  # noqa: FBT001, FBT002
         super().__init__()
 
         self.validator = Validator()
         self.dataconverter = DataConverter()
+        self.kernelselector = KernelSelector(conv_engine=conv_engine, conv_scratch_size=conv_scratch_size)
+
+        self.output_to(output_path)
+
+        self.dump_featuremaps = dump_featuremaps
+        # Execute depthwise convolution → (BatchNorm) → pointwise convolution as a single layer with a line buffer, the fused
+        # layer only has a portable kernel so CMSIS-NN/NMSIS-NN builds should keep the separate layers
+        self.fuse_separable_conv = fuse_separable_conv
+        # Maximum number of samples processed by each layer at once by cnn_batch(), activations are allocated for this number
+        # of samples
+        self.max_batch = max_batch
+        # Run independent branches of the model concurrently on the thread pool when built with WITH_THREADS
+        self.branch_parallelism = branch_parallelism
+        # Number of threads streaming the samples of cnn_batch() through consecutive groups of layers when built with
+        # WITH_THREADS, layers are split in this number of stages of balanced multiply-accumulate operations
+        self.pipeline_stages = pipeline_stages
+        # Number of new input samples of each cnn_push() call sliding the input window, 0 to not generate cnn_push()
+        self.stream_hop = stream_hop
+        # Generate cnn_update() recomputing the first 2D layers only on the output rows depending on a band of changed input rows
+        self.partial_update = partial_update
+        # Generate cnn_sequence() running 1D models on inputs shorter than the input length of the model
+        self.variable_length = variable_length
+        # Place the activations at offsets of a single arena planned from their size and lifetime, when it is smaller than the
+        # unions of greedy pools
+        self.activations_arena = activations_arena
+        # Split computing: name of the last layer of the head package, the tail package computes the next layers from its output
+        # received in a link frame. 'auto' selects the boundary with the fewest bytes, None generates a single model
+        self.split_layer = split_layer
+
+        self.number_types = {NumberType(int, 32, 64, -(2 ** (32 - 1)), 2 ** (32 - 1) - 1)}
 
+        self._template_path: list[Path] | None = None
+        if isinstance(Converter.TEMPLATE_PATH, Path): # Already Path objected, no need for hackery
+            self._template_path = [Converter.TEMPLATE_PATH]
+        elif sys.version_info >= (3, 10): # Python 3.10 may return MultiplexedPath
+            from importlib.readers import MultiplexedPath
+            if isinstance(Converter.TEMPLATE_PATH, MultiplexedPath):
+                self._template_path = [Converter.TEMPLATE_PATH / ''] # / operator applies to underlying Path
+
+    def output_to(self, output_path: Path | None) -> None:
         if output_path:
             self.output_path = output_path
             self.output_path_header = output_path / 'include'
@@ -88,39 +145,35 @@ class Converter:
 
             self.write_file = False
 
-        self.dump_featuremaps = dump_featuremaps
-
-        self.number_types = {NumberType(int, 32, 64, -(2 ** (32 - 1)), 2 ** (32 - 1) - 1)}
-
-        self._template_path: list[Path] | None = None
-        if isinstance(Converter.TEMPLATE_PATH, Path): # Already Path objected, no need for hackery
-            self._template_path = [Converter.TEMPLATE_PATH]
-        elif sys.version_info >= (3, 10): # Python 3.10 may return MultiplexedPath
-            from importlib.readers import MultiplexedPath
-            if isinstance(Converter.TEMPLATE_PATH, MultiplexedPath):
-                self._template_path = [Converter.TEMPLATE_PATH / ''] # / operator applies to underlying Path
-
     def weights2carray(self, node: LayerNode) -> dict[str, dict[str, str | tuple[int, ...]]]:
         return {name: self.dataconverter.tensor2carray(arr, f'{node.layer.name}_{name}')
                 for name, arr in node.layer.weights.items()}
 
-    def write_layer_function(self, template: str, node: LayerNode) -> str:
+    def packed_weights2carray(self, node: LayerNode, options: dict[str, Any]) -> dict[str, dict[str, str | tuple[int, ...]]]:
+        return {name: self.dataconverter.tensor2carray(arr, f'{node.layer.name}_{name}')
+                for name, arr in self.kernelselector.pack_weights(node, options).items()}
+
+    def write_layer_function(self, template: str, node: LayerNode, options: dict[str, Any]) -> str:
         return self.render_template('layers/' + template + '.cc',
                                     self.output_path / f'{node.layer.name}.c',
                                     node=node,
+                                    options=options,
                                     qtype2ctype=self.dataconverter.qtype2ctype)
 
-    def write_layer_header(self, template: str, node: LayerNode) -> str:
+    def write_layer_header(self, template: str, node: LayerNode, options: dict[str, Any]) -> str:
         return self.render_template('include/layers/' + template + '.hh',
                                     self.output_path_header / f'{node.layer.name}.h',
                                     node=node,
+                                    options=options,
                                     qtype2ctype=self.dataconverter.qtype2ctype)
 
-    def write_layer_weights(self, template: str, node: LayerNode) -> str:
+    def write_layer_weights(self, template: str, node: LayerNode, options: dict[str, Any]) -> str:
         return self.render_template('layers/weights/' + template + '.cc',
                                     self.output_path_weights / f'{node.layer.name}.c',
                                     node=node,
-                                    weights=self.weights2carray(node))
+                                    options=options,
+                                    weights=self.weights2carray(node),
+                                    packed_weights=self.packed_weights2carray(node, options))
 
     def render_template(self,
                         name: str,
@@ -138,15 +191,26 @@ class Converter:
                 _ = f.write(rendered)
         return rendered
 
-    def write_model_header(self, modelgraph: ModelGraph) -> str:
+    def write_model_header(self,
+                           modelgraph: ModelGraph,
+                           allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int] | None,
+                           node_options: dict[LayerNode, dict[str, Any]],
+                           schedule: dict[str, Any] | None = None) -> str:
         return self.render_template('include/model.hh', self.output_path_header / 'model.h', nodes=modelgraph.nodes,
+                                    allocation=allocation,
+                                    options=node_options,
+                                    schedule=schedule or {},
                                     qtype2ctype=self.dataconverter.qtype2ctype)
 
     def write_model(self,
                     modelgraph: ModelGraph,
-                    allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int]] | None) -> str:
+                    allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int] | None,
+                    node_options: dict[LayerNode, dict[str, Any]],
+                    schedule: dict[str, Any] | None = None) -> str:
         return self.render_template('model.cc', self.output_path / 'model.c', nodes=modelgraph.nodes,
                                     allocation=allocation,
+                                    options=node_options,
+                                    schedule=schedule or {},
                                     qtype2ctype=self.dataconverter.qtype2ctype,
                                     dump_featuremaps=self.dump_featuremaps,
                                     dump_featuremaps_path=self.output_path_featuremaps)
@@ -156,6 +220,14 @@ class Converter:
                                     number_types=self.number_types,
                                     qtype2ctype=self.dataconverter.qtype2ctype)
 
+    def write_parallel_header(self) -> str:
+        return self.render_template('include/parallel.hh', self.output_path_header / 'parallel.h')
+
+    def write_link_header(self, node: LayerNode) -> str:
+        return self.render_template('include/link.hh', self.output_path_header / 'link.h',
+                                    node=node,
+                                    qtype2ctype=self.dataconverter.qtype2ctype)
+
     def write_defines_header(self, modelgraph: ModelGraph) -> str:
         return self.render_template('include/defines.hh', self.output_path_header / 'defines.h', nodes=modelgraph.nodes)
 
@@ -234,6 +306,68 @@ class Converter:
         # Rename operator layers that are not valid identifiers for C
         return self.rename_operators(optimized_modelgraph)
 
+    # Input node of a node with a single input, if this node is the only one using its output
+    def exclusive_innode(self, node: LayerNode) -> LayerNode | None:
+        if len(node.innodes) != 1 or len(node.innodes[0].outnodes) != 1:
+            return None
+        return node.innodes[0]
+
+    def separable_conv_nodes(self, pointwisenode: LayerNode) -> list[LayerNode] | None:
+        """Find depthwise convolution → (BatchNorm) → pointwise convolution chain ending with pointwisenode.
+
+        Intermediate outputs must only be used by the next node of the chain and all nodes must share the same number type.
+        """
+        pointwise = pointwisenode.layer
+        if (not isinstance(pointwise, (layers.TConv1DLayer, layers.TConv2DLayer))
+            or pointwise.groups != 1
+            or any(ks != 1 for ks in pointwise.kernel_size)
+            # Padding may also be the 'valid' string from Keras
+            or (not isinstance(pointwise.padding, str) and any(np.ravel(pointwise.padding)))):
+            return None
+
+        conv2d = isinstance(pointwise, layers.TConv2DLayer)
+        batchnorm_type = layers.TBatchNormalization2DLayer if conv2d else layers.TBatchNormalization1DLayer
+
+        nodes = [pointwisenode]
+        innode = self.exclusive_innode(pointwisenode)
+        if innode is not None and isinstance(innode.layer, batchnorm_type):
+            nodes.insert(0, innode)
+            innode = self.exclusive_innode(innode)
+        if (innode is None
+            or not isinstance(innode.layer, pointwise.__class__)
+            or self.kernelselector.conv_engine(innode) != 'depthwise'):
+            return None
+        nodes.insert(0, innode)
+
+        if any((node.q.number_type, node.q.width, node.q.long_width)
+               != (pointwisenode.q.number_type, pointwisenode.q.width, pointwisenode.q.long_width) for node in nodes):
+            return None
+
+        return nodes
+
+    def combine_separable_conv(self, modelgraph: ModelGraph) -> ModelGraph:
+        pointwisenodes = [node for node in modelgraph.nodes if isinstance(node.layer, (layers.TConv1DLayer, layers.TConv2DLayer))]
+        for pointwisenode in pointwisenodes:
+            nodes = self.separable_conv_nodes(pointwisenode)
+            if nodes is None:
+                continue
+
+            depthwisenode = nodes[0]
+            conv2d = isinstance(pointwisenode.layer, layers.TConv2DLayer)
+            layer_type = layers.TSeparableConv2DLayer if conv2d else layers.TSeparableConv1DLayer
+            layer = layer_type(input_shape=depthwisenode.layer.input_shape,
+                               output_shape=pointwisenode.layer.output_shape,
+                               output_dtype=pointwisenode.layer.output_dtype,
+                               name=f'{depthwisenode.layer.name}_{pointwisenode.layer.name}',
+                               depthwise=depthwisenode,
+                               batchnorm=nodes[1] if len(nodes) > 2 else None,  # noqa: PLR2004
+                               pointwise=pointwisenode)
+
+            logger.info('Fusing %s into "%s"', [node.layer.name for node in nodes], layer.name)
+            # Fused node outputs the result of the pointwise convolution
+            modelgraph.fuse_nodes(nodes, LayerNode(layer, q=pointwisenode.q))
+        return modelgraph
+
     def validate_modelgraph(self, modelgraph: ModelGraph) -> bool:
         return all(self.validator.validate_node(node) for node in modelgraph.nodes)
 
@@ -260,7 +394,8 @@ class Converter:
         return True
 
     def generate_code(self, modelgraph: ModelGraph,
-                      allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int]]) -> str:
+                      allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int],
+                      schedule: dict[str, Any] | None = None) -> str:
         # Used to ignore includes in generated files for combined returned code
         rendered = '#define SINGLE_FILE\n'
 
@@ -270,23 +405,342 @@ class Converter:
         # Write number.h numeric type configuration
         rendered += self.write_numeric_header()
 
+        # Write parallel.h thread pool used by layers split across threads
+        rendered += self.write_parallel_header()
+
+        # Write link.h frame codec of the tensor exchanged by the head and tail packages of a split model
+        if schedule and 'link' in schedule:
+            rendered += self.write_link_header(schedule['link'])
+
+        # Kernel implementation selected for each layer, also used by the model to allocate scratch buffers
+        node_options: dict[LayerNode, dict[str, Any]] = {}
+        stream_shifts: dict[LayerNode, int] = schedule['stream']['shifts'] if schedule and 'stream' in schedule else {}
+        update_rows: dict[LayerNode, dict[str, int]] = schedule['update_rows'] if schedule and 'update_rows' in schedule else {}
+        sequence: list[LayerNode] = schedule['sequence'] if schedule and 'sequence' in schedule else []
+
         for node in modelgraph.nodes:
             template = self.layer_template_files[node.layer.__class__]
             # Skip layers with no code to generate
             if template is None:
                 continue
 
-            rendered += self.write_layer_header(template=template, node=node) + '\n'
-            rendered += self.write_layer_function(template=template, node=node) + '\n'
+            # Kernel implementation selected for this layer
+            options = self.kernelselector.select(node,
+                                                 stream_shift=stream_shifts.get(node, 0),
+                                                 rows_update=node in update_rows,
+                                                 sequence=node in sequence)
+            node_options[node] = options
+
+            rendered += self.write_layer_header(template=template, node=node, options=options) + '\n'
+            rendered += self.write_layer_function(template=template, node=node, options=options) + '\n'
             if hasattr(node.layer, 'weights') and len(node.layer.weights) > 0:
-                rendered += self.write_layer_weights(template=template, node=node) + '\n'
+                rendered += self.write_layer_weights(template=template, node=node, options=options) + '\n'
+
+        # Scratch buffers of layers that never run at the same time overlap in the context
+        allocation = {**allocation,
+                      'scratch': Allocator.scratch_pools(modelgraph,
+                                                         [node for node, options in node_options.items() if options['scratch']],
+                                                         concurrent_branches=bool(schedule and schedule.get('task_graph')))}
+
+        rendered += self.write_model_header(modelgraph=modelgraph,
+                                            allocation=allocation,
+                                            node_options=node_options,
+                                            schedule=schedule) + '\n'
+        rendered += self.write_model(modelgraph=modelgraph,
+                                     allocation=allocation,
+                                     node_options=node_options,
+                                     schedule=schedule) + '\n'
+
+        return rendered
+
 
+    def pipeline(self, modelgraph: ModelGraph) -> list[list[LayerNode]]:
+        """Split the layers in :attr:`pipeline_stages` consecutive stages.
+
+        Stages minimize the multiply-accumulate operations of the largest one. Layers only read outputs of previous layers so a
+        stage never depends on a later one.
+        """
+        nodes = modelgraph.nodes[1:]
+        stages = min(self.pipeline_stages, len(nodes))
+        macs = [0]
+        for node in nodes:
+            macs.append(macs[-1] + self.kernelselector.macs(node))
+
+        # cost[s][i]: largest stage when splitting the first i layers in s stages, cut[s][i]: first layer of the last stage
+        cost = [[0.0 if i == 0 else math.inf for i in range(len(nodes) + 1)]]
+        cut = [[0] * (len(nodes) + 1)]
+        for s in range(1, stages + 1):
+            cost.append([math.inf] * (len(nodes) + 1))
+            cut.append([0] * (len(nodes) + 1))
+            for i in range(s, len(nodes) + 1):
+                for j in range(s - 1, i):
+                    c = max(cost[s - 1][j], macs[i] - macs[j])
+                    if c < cost[s][i]:
+                        cost[s][i], cut[s][i] = c, j
+
+        bounds = [len(nodes)]
+        for s in range(stages, 0, -1):
+            bounds.insert(0, cut[s][bounds[0]])
+
+        pipeline = [nodes[start:end] for start, end in zip(bounds[:-1], bounds[1:])]
+        for i, stage in enumerate(pipeline):
+            logger.info('Pipeline stage %d: %s, %d MACs',
+                        i,
+                        [node.layer.name for node in stage],
+                        sum(self.kernelselector.macs(node) for node in stage))
+        return pipeline
+
+    def schedule(self,
+                 modelgraph: ModelGraph,
+                 allocator: Allocator,
+                 allocation: dict[str, list[list[LayerNode]] | dict[LayerNode, int] | int]) -> dict[str, Any]:
+        """Select how cnn_r() and cnn_batch() run the layers when built with WITH_THREADS.
+
+        :return: ``pipeline`` stages of :meth:`pipeline` or ``task_graph`` of :meth:`Allocator.task_graph`, empty to run the
+            layers sequentially
+        """
+        if self.pipeline_stages <= 1 and not self.branch_parallelism:
+            return {}
+        if self.dump_featuremaps or allocator.max_batch > 1:
+            logger.warning('Layers run sequentially when dumping feature maps or processing mini-batches')
+            return {}
+        if self.pipeline_stages > 1:
+            if self.branch_parallelism:
+                logger.warning('Branches run sequentially inside pipeline stages')
+            pipeline = self.pipeline(modelgraph)
+            if len(pipeline) < 2:  # noqa: PLR2004 cnn_batch() hands samples over from the first stage to the second
+                logger.warning('Layers run sequentially, the model has fewer layers than two pipeline stages')
+                return {}
+            return {'pipeline': pipeline}
+        return {'task_graph': allocator.task_graph(modelgraph, allocation)}
+
+    def stream_shifts(self, modelgraph: ModelGraph) -> dict[LayerNode, int] | None:
+        """Find the first layers computed incrementally by cnn_push() when the input window slides by :attr:`stream_hop`.
+
+        Conv1D without padding, MaxPool1D and AveragePool1D layers following the input, or each other in a chain, produce the
+        output of the previous window shifted by stream_hop divided by their cumulated stride, only their last output positions
+        need to be computed. Their outputs are kept in the context between two calls.
+
+        :return: Number of output positions shifted by each call for each streamed layer, ``None`` if cnn_push() is not
+            generated
+        """
+        if self.stream_hop <= 0:
+            return None
+        if self.dump_featuremaps or self.max_batch > 1:
+            logger.warning('cnn_push() is not generated when dumping feature maps or processing mini-batches')
+            return None
+        inputnode = modelgraph.nodes[0]
+        if len(inputnode.output_shape[0]) != 3 or not 0 < self.stream_hop < inputnode.output_shape[0][-2]:  # noqa: PLR2004
+            logger.warning('cnn_push() requires a 1D input longer than stream_hop')
+            return None
 
-        rendered += self.write_model_header(modelgraph=modelgraph) + '\n'
-        rendered += self.write_model(modelgraph=modelgraph, allocation=allocation) + '\n'
+        shifts: dict[LayerNode, int] = {}
+        previous, shift = inputnode, self.stream_hop
+        # Output of last layer is written to the output of the caller, not kept
+        for node in modelgraph.nodes[1:-1]:
+            if not ((isinstance(node.layer, layers.TConv1DLayer) and not any(node.layer.padding))
+                    or isinstance(node.layer, (layers.TMaxPooling1DLayer, layers.TAvgPooling1DLayer))):
+                break
+            stride = node.layer.strides[0]
+            if (node.innodes != [previous]
+                or node.q.number_type != previous.q.number_type or node.q.width != previous.q.width
+                or shift % stride != 0 or shift // stride >= node.output_shape[0][-2]):
+                break
+            previous, shift = node, shift // stride
+            shifts[node] = shift
+
+        logger.info('Streaming %s with cnn_push()', [node.layer.name for node in shifts])
+        return shifts
+
+    def update_rows(self, modelgraph: ModelGraph) -> dict[LayerNode, dict[str, int]] | None:
+        """Find the first layers recomputed by cnn_update() only on the output rows depending on changed input rows.
+
+        Conv2D, MaxPool2D, AveragePool2D and Upsample layers following the input, or each other in a chain, keep their output
+        of the previous frame in the context. A band of changed rows of their input is propagated through the rows of their
+        window: the input is first upsampled by scale, then output row y reads rows [y * stride - padding, y * stride - padding
+        + kernel).
+
+        :return: Vertical kernel size, stride, top padding and upsampling scale of each updated layer, ``None`` if cnn_update()
+            is not generated
+        """
+        if not self.partial_update:
+            return None
+        if self.dump_featuremaps or self.max_batch > 1:
+            logger.warning('cnn_update() is not generated when dumping feature maps or processing mini-batches')
+            return None
+        inputnode = modelgraph.nodes[0]
+        if len(inputnode.output_shape[0]) != 4:  # noqa: PLR2004
+            logger.warning('cnn_update() requires a 2D input')
+            return None
 
+        rows: dict[LayerNode, dict[str, int]] = {}
+        previous = inputnode
+        # Output of last layer is written to the output of the caller, not kept
+        for node in modelgraph.nodes[1:-1]:
+            if (node.innodes != [previous] or len(node.input_shape[0]) != 4  # noqa: PLR2004
+                or node.q.number_type != previous.q.number_type or node.q.width != previous.q.width):
+                break
+            if isinstance(node.layer, layers.TConv2DLayer):
+                rows[node] = {'kernel': node.layer.kernel_size[0], 'stride': node.layer.strides[0],
+                              'padding': node.layer.padding[0][0], 'scale': 1}
+            elif isinstance(node.layer, (layers.TMaxPooling2DLayer, layers.TAvgPooling2DLayer)):
+                rows[node] = {'kernel': node.layer.pool_size[0], 'stride': node.layer.strides[0], 'padding': 0, 'scale': 1}
+            elif isinstance(node.layer, layers.TUpsampleLayer):
+                rows[node] = {'kernel': 1, 'stride': 1, 'padding': 0,
+                              'scale': node.output_shape[0][-3] // node.input_shape[0][-3]}
+            else:
+                break
+            previous = node
+
+        logger.info('Updating %s with cnn_update()', [node.layer.name for node in rows])
+        return rows
+
+    def incremental_schedule(self, modelgraph: ModelGraph) -> dict[str, Any]:
+        """Schedule entries of the optional streamed, row-updated and variable-length inference functions."""
+        incremental: dict[str, Any] = {}
+        stream_shifts = self.stream_shifts(modelgraph)
+        if stream_shifts is not None:
+            incremental['stream'] = {'hop': self.stream_hop, 'shifts': stream_shifts}
+        update_rows = self.update_rows(modelgraph)
+        if update_rows is not None:
+            incremental['update_rows'] = update_rows
+        sequence = self.sequence_layers(modelgraph)
+        if sequence is not None:
+            incremental['sequence'] = sequence
+        return incremental
+
+    def sequence_layers(self, modelgraph: ModelGraph) -> list[LayerNode] | None:
+        """Find the layers computed by cnn_sequence() on the valid length of a shorter input.
+
+        Conv1D, MaxPool1D and AveragePool1D layers following the input in a chain only compute the output positions of the
+        valid input samples. The chain must reach the model output, optionally reduced by a global Sum over the sequence.
+
+        :return: Layers of the chain, ``None`` if cnn_sequence() is not generated
+        """
+        if not self.variable_length:
+            return None
+        if self.dump_featuremaps or self.max_batch > 1:
+            logger.warning('cnn_sequence() is not generated when dumping feature maps or processing mini-batches')
+            return None
+        if len(modelgraph.nodes[0].output_shape[0]) != 3:  # noqa: PLR2004
+            logger.warning('cnn_sequence() requires a 1D input')
+            return None
+
+        sequence: list[LayerNode] = []
+        previous = modelgraph.nodes[0]
+        for node in modelgraph.nodes[1:]:
+            # Another reader of the previous layer would read past its valid output positions
+            if node.innodes != [previous] or len(previous.outnodes) != 1:
+                break
+            if isinstance(node.layer, layers.TSumLayer) and len(node.input_shape[0]) == 3:  # noqa: PLR2004
+                sequence.append(node)
+                break
+            if not isinstance(node.layer, (layers.TConv1DLayer, layers.TMaxPooling1DLayer, layers.TAvgPooling1DLayer)):
+                break
+            sequence.append(node)
+            previous = node
+
+        if len(sequence) < len(modelgraph.nodes) - 1:
+            logger.warning('cnn_sequence() requires Conv1D, MaxPool1D and AveragePool1D layers up to the output or a Sum, '
+                           'stopped at %s', modelgraph.nodes[len(sequence) + 1].layer.name)
+            return None
+
+        logger.info('Variable-length %s with cnn_sequence()', [node.layer.name for node in sequence])
+        return sequence
+
+    def split_boundaries(self, modelgraph: ModelGraph) -> list[LayerNode]:
+        """Layers whose output is the only activation used by the next layers, the model can be split after one of them."""
+        nodes = modelgraph.nodes
+        boundaries: list[LayerNode] = []
+        for i, node in enumerate(nodes[1:-1], start=1):
+            head = set(nodes[:i + 1])
+            if all(innode is node or innode not in head for later in nodes[i + 1:] for innode in later.innodes):
+                boundaries.append(node)
+        return boundaries
+
+    def split_boundary(self, modelgraph: ModelGraph) -> LayerNode | None:
+        boundaries = self.split_boundaries(modelgraph)
+
+        def size(node: LayerNode) -> int:
+            return math.prod(node.output_shape[0][1:]) * (node.q.width or 0) // 8
+
+        if self.split_layer == 'auto':
+            # Fewest bytes sent, earliest layer to keep the head small on ties
+            boundary = min(boundaries, key=size, default=None)
+        else:
+            boundary = next((node for node in boundaries if node.layer.name == self.split_layer), None)
+        if boundary is None:
+            logger.error('Cannot split the model after "%s", possible layers: %s',
+                         self.split_layer, [node.layer.name for node in boundaries])
+            return None
+
+        logger.info('Split after "%s", %d bytes sent per inference without run-length encoding',
+                    boundary.layer.name, size(boundary))
+        return boundary
+
+    def split_modelgraph(self, modelgraph: ModelGraph, boundary: LayerNode) -> tuple[ModelGraph, ModelGraph]:
+        """Head graph ending with boundary and tail graph with an InputLayer for the output of boundary.
+
+        Nodes are copied to relink them, layers and quantization information are shared with modelgraph.
+        """
+        index = modelgraph.nodes.index(boundary)
+        headnodes = {node: LayerNode(node.layer, q=node.q) for node in modelgraph.nodes[:index + 1]}
+
+        inputlayer = layers.TInputLayer(input_shape=boundary.layer.output_shape,
+                                        output_shape=boundary.layer.output_shape,
+                                        output_dtype=boundary.layer.output_dtype,
+                                        name=f'{boundary.layer.name}_input')
+        tailnodes = {boundary: LayerNode(inputlayer, q=boundary.q)}
+        tailnodes.update({node: LayerNode(node.layer, q=node.q) for node in modelgraph.nodes[index + 1:]})
+
+        for nodes in (headnodes, tailnodes):
+            for node, partnode in nodes.items():
+                partnode.innodes = [nodes[innode] for innode in node.innodes if innode in nodes]
+                partnode.outnodes = [nodes[outnode] for outnode in node.outnodes if outnode in nodes]
+
+        return ModelGraph(list(headnodes.values())), ModelGraph(list(tailnodes.values()))
+
+    def convert_split(self, modelgraph: ModelGraph) -> str | bool:
+        """Generate the head and tail packages of a model split after :attr:`split_layer`.
+
+        Each package is generated in its own ``head`` or ``tail`` subdirectory with ``include/link.h`` to exchange the output of
+        the boundary layer.
+        """
+        boundary = self.split_boundary(modelgraph)
+        if boundary is None:
+            return False
+        head, tail = self.split_modelgraph(modelgraph, boundary)
+
+        output_path = self.output_path if self.write_file else None
+        rendered = ''
+        for name, part, link in (('head', head, head.nodes[-1]), ('tail', tail, tail.nodes[0])):
+            self.output_to(output_path / name if output_path else None)
+            code = self.generate_package(part, link=link)
+            if not code:
+                logger.error('Could not generate %s package', name)
+                self.output_to(output_path)
+                return False
+            rendered += cast('str', code)
+        self.output_to(output_path)
         return rendered
 
+    def generate_package(self, modelgraph: ModelGraph, link: LayerNode | None = None) -> str | bool:
+        incremental = self.incremental_schedule(modelgraph)
+
+        allocator = Allocator(max_batch=1 if self.dump_featuremaps else self.max_batch,
+                              concurrent_branches=self.branch_parallelism,
+                              persistent=[*incremental.get('stream', {}).get('shifts', {}), *incremental.get('update_rows', {})],
+                              arena=self.activations_arena)
+        allocation = allocator(modelgraph)
+        if not allocation:
+            logger.error('Allocation failed')
+            return False
+
+        schedule = self.schedule(modelgraph, allocator, allocation) | incremental
+        if link is not None:
+            schedule['link'] = link
+
+        return self.generate_code(modelgraph, allocation, schedule)
 
     def convert_model(self, modelgraph: ModelGraph) -> str | bool:
         if self._template_path is None:
@@ -305,10 +759,13 @@ class Converter:
         if not self.quantize_modelgraph(final_modelgraph):
             return False
 
-        allocator = Allocator()
-        allocation = allocator(modelgraph)
-        if not allocation:
-            logger.error('Allocation failed')
-            return False
+        # After quantization since fused nodes keep their own weights and quantization information
+        # Intermediate outputs of fused layers are not available to dump feature maps
+        if self.fuse_separable_conv and not self.dump_featuremaps:
+            final_modelgraph = self.combine_separable_conv(final_modelgraph)
 
-        return self.generate_code(final_modelgraph, allocation)
+        if self.dump_featuremaps and self.max_batch > 1:
+            logger.warning('Feature maps are dumped for each sample, mini-batches are disabled')
+        if self.split_layer is not None:
+            return self.convert_split(final_modelgraph)
+        return self.generate_package(final_modelgraph)
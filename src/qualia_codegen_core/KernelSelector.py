@@ -0,0 +1,518 @@
+# Copyright 2021 (c) Pierre-Emmanuel Novac <penovac@unice.fr> Université Côte d'Azur, CNRS, LEAT. All rights reserved.
+
+from __future__ import annotations
+
+import logging
+import math
+from fractions import Fraction
+from typing import Any, Final
+
+import numpy as np
+
+from qualia_codegen_core.typing import TYPE_CHECKING, NDArrayFloatOrInt
+
+from .graph.layers import (
+    TAvgPoolingLayer,
+    TConv1DLayer,
+    TConv2DLayer,
+    TDenseLayer,
+    TMaxPooling1DLayer,
+    TMaxPoolingLayer,
+    TSeparableConv2DLayer,
+    TSeparableConvLayer,
+    TSumLayer,
+)
+
+if TYPE_CHECKING:
+    from .graph.LayerNode import LayerNode
+
+logger = logging.getLogger(__name__)
+
+class KernelSelector:
+    """Select the kernel implementation used by the portable C path of each layer.
+
+    The selected implementation and its parameters are passed to the layer templates as ``options``.
+    """
+
+    conv_engines: Final[tuple[str, ...]] = ('direct', 'im2col', 'winograd')
+
+    # Winograd F(m, 3) transforms from Lavin & Gray, "Fast Algorithms for Convolutional Neural Networks", indexed by m:
+    # output = A^T [(G kernel) * (B^T input)] for alpha = m + 2 input samples
+    winograd_bt: Final[dict[int, list[list[int]]]] = {
+        2: [[1, 0, -1, 0],
+            [0, 1, 1, 0],
+            [0, -1, 1, 0],
+            [0, 1, 0, -1]],
+        4: [[4, 0, -5, 0, 1, 0],
+            [0, -4, -4, 1, 1, 0],
+            [0, 4, -4, -1, 1, 0],
+            [0, -2, -1, 2, 1, 0],
+            [0, 2, -1, -2, 1, 0],
+            [0, 4, 0, -5, 0, 1]],
+    }
+    winograd_g: Final[dict[int, list[list[Fraction]]]] = {
+        2: [[Fraction(1), Fraction(0), Fraction(0)],
+            [Fraction(1, 2), Fraction(1, 2), Fraction(1, 2)],
+            [Fraction(1, 2), Fraction(-1, 2), Fraction(1, 2)],
+            [Fraction(0), Fraction(0), Fraction(1)]],
+        4: [[Fraction(1, 4), Fraction(0), Fraction(0)],
+            [Fraction(-1, 6), Fraction(-1, 6), Fraction(-1, 6)],
+            [Fraction(-1, 6), Fraction(1, 6), Fraction(-1, 6)],
+            [Fraction(1, 24), Fraction(1, 12), Fraction(1, 6)],
+            [Fraction(1, 24), Fraction(-1, 12), Fraction(1, 6)],
+            [Fraction(0), Fraction(0), Fraction(1)]],
+    }
+    winograd_at: Final[dict[int, list[list[int]]]] = {
+        2: [[1, 1, 1, 0],
+            [0, 1, -1, -1]],
+        4: [[1, 1, 1, 1, 1, 0],
+            [0, 1, -1, 2, -2, 0],
+            [0, 1, 1, 4, 4, 0],
+            [0, 1, -1, 8, -8, 1]],
+    }
+
+    def __init__(self,
+                 conv_engine: str = 'direct',
+                 conv_scratch_size: int = 8192,
+                 gemm_tile: tuple[int, int] = (4, 8),
+                 conv_tile: tuple[int, int] = (2, 4)) -> None:
+        """Construct :class:`KernelSelector`.
+
+        :param conv_engine: Preferred engine for convolutions, one of :attr:`conv_engines`. ``'im2col'`` uses the im2col +
+            packed GEMM engine for convolutions without groups, ``'winograd'`` uses Winograd minimal filtering for 3 or 3x3
+            convolutions with stride 1 and without groups in float or int16 (32-bit accumulator). Other layers use the direct
+            convolution
+        :param conv_scratch_size: Maximum size in bytes of the im2col buffer or of the Winograd transformed input buffer of a
+            layer, the buffer is processed in blocks of output positions or tiles if it does not fit
+        :param gemm_tile: Number of output positions and filters computed at once by the GEMM microkernel, kernel is packed in
+            panels of this number of filters
+        :param conv_tile: Number of output positions and filters computed at once by the direct convolution
+        """
+        super().__init__()
+        # Number of channels of the depthwise convolution tile, vectorized in channels_last order
+        self.depthwise_tile_c = 16
+        # Number of units of the fully-connected tile computed in one pass over the input, kernel is packed in panels of this
+        # number of units
+        self.fc_tile = 4
+        # Maximum size in bytes of the block of input of a fully-connected layer reused by all panels before moving to the
+        # next block, larger inputs keep the accumulators of all units
+        self.fc_input_block_size = 8192
+        # Number of samples of a mini-batch computed at once by the fully-connected tile of cnn_batch(), each weight loaded is
+        # used for all of them
+        self.fc_batch_tile = 4
+        # Minimum number of multiply-accumulate operations (comparisons or additions for pooling) of a layer for its output to
+        # be split across the threads of the pool when built with WITH_THREADS, smaller layers run on the calling thread
+        self.parallel_min_ops = 1 << 17
+        # Number of channels of the chunks of MaxPool1D split across threads, channels are innermost in its loops
+        self.parallel_channel_grain = 8
+        if conv_engine not in self.conv_engines:
+            logger.warning('Unknown convolution engine "%s", using direct convolution', conv_engine)
+        self.conv_engine_preference = conv_engine
+        self.conv_scratch_size = conv_scratch_size
+        self.gemm_mr, self.gemm_nr = gemm_tile
+        self.conv_tile_x, self.conv_tile_k = conv_tile
+
+    def __padding(self, node: LayerNode) -> tuple[int, ...]:
+        # Padding may also be the 'valid' string from Keras
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)) or isinstance(node.layer.padding, str):
+            return (0, 0, 0, 0)
+        if isinstance(node.layer, TConv2DLayer):
+            return (*node.layer.padding[0], *node.layer.padding[1])
+        return tuple(node.layer.padding)
+
+    def conv_engine(self, node: LayerNode, partial: bool = False) -> str:  # noqa: FBT001, FBT002
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return 'direct'
+
+        # Depthwise convolution always uses its dedicated kernel, other grouped convolutions run each group as an independent
+        # convolution in the direct engine
+        if node.layer.groups > 1 and node.layer.groups == node.input_shape[0][-1]:
+            return 'depthwise'
+
+        # Streamed, updated and variable-length layers compute a range of output positions or rows, only available with the
+        # direct engine
+        if partial:
+            return 'direct'
+
+        if self.conv_engine_preference == 'im2col' and node.layer.groups == 1:
+            return 'im2col'
+
+        if self.conv_engine_preference == 'winograd' and self.winograd_supported(node):
+            return 'winograd'
+
+        return 'direct'
+
+    def winograd_supported(self, node: LayerNode) -> bool:
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)) or node.layer.groups != 1:
+            return False
+        if any(ks != 3 for ks in node.layer.kernel_size) or any(s != 1 for s in node.layer.strides):  # noqa: PLR2004
+            return False
+        # Transformed operands grow beyond the range of the 16-bit accumulator of int8 layers
+        return node.q.number_type is float or (node.q.long_width is not None and node.q.long_width >= 32)  # noqa: PLR2004
+
+    def gemm_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute GEMM tiling and im2col buffer size of a convolution layer.
+
+        Output is computed as ``output[M][N] = im2col(input)[M][K] * kernel[N][K]^T`` with ``M`` the number of output
+        positions, ``N`` the number of filters and ``K`` the size of the receptive field.
+        """
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)) or node.q.width is None:
+            return {}
+
+        m = math.prod(node.output_shape[0][1:-1])
+        k = math.prod(node.layer.kernel_size) * node.input_shape[0][-1] // node.layer.groups
+
+        unpadded = not any(self.__padding(node))
+        # Rows of the im2col matrix can be read directly from the input: with Conv1D overlapping windows are contiguous,
+        # with 1x1 Conv2D each output position is an input pixel
+        direct = unpadded and (isinstance(node.layer, TConv1DLayer)
+                               or (all(ks == 1 for ks in node.layer.kernel_size)
+                                   and all(s == 1 for s in node.layer.strides)))
+
+        if direct:
+            rows = m
+        else:
+            # im2col buffer holds as many blocks of GEMM_MR rows as the scratch size allows, at least one
+            rows = (self.conv_scratch_size // (k * math.ceil(node.q.width / 8))) // self.gemm_mr * self.gemm_mr
+            rows = min(max(rows, self.gemm_mr), m)
+
+        return {'mr': self.gemm_mr,
+                'nr': self.gemm_nr,
+                'm': m,
+                'k': k,
+                'panels': math.ceil(node.layer.filters / self.gemm_nr),
+                'rows': rows,
+                'im2col': not direct}
+
+    def tile_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute output-stationary tile of the direct convolution: tile of output positions x filters kept in registers.
+
+        Number of filters of the tile divides the number of filters per group so that tiles never need to be truncated.
+        """
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {}
+
+        filters_per_group = node.layer.filters // node.layer.groups
+
+        return {'x': min(self.conv_tile_x, node.output_shape[0][-2]),
+                'k': max(k for k in range(1, min(self.conv_tile_k, filters_per_group) + 1) if filters_per_group % k == 0)}
+
+    def depthwise_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute channel tile of the depthwise convolution, largest divisor of the number of filters up to the tile size."""
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {}
+
+        return {'multiplier': node.layer.filters // node.layer.groups,
+                'tile_c': max(c for c in range(1, min(self.depthwise_tile_c, node.layer.filters) + 1)
+                              if node.layer.filters % c == 0)}
+
+    def fc_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute tile of units and input block of a fully-connected layer.
+
+        Each pass over the input computes a panel of ``tile`` units, last panel is zero-padded. Input larger than the block
+        size is processed in blocks of samples, each block is read by all panels while it is in cache. Mini-batches are
+        processed in tiles of ``batch_tile`` samples sharing each panel.
+        """
+        if not isinstance(node.layer, TDenseLayer) or node.q.width is None:
+            return {}
+
+        tile = min(self.fc_tile, node.layer.units)
+        samples = node.input_shape[0][-1]
+
+        return {'tile': tile,
+                'panels': math.ceil(node.layer.units / tile),
+                'input_block': min(max(self.fc_input_block_size // math.ceil(node.q.width / 8), 1), samples),
+                'batch_tile': self.fc_batch_tile}
+
+    def separable_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute depthwise tile, pointwise tile, interior range and line buffer size of a fused separable convolution.
+
+        Output position ``i`` reads the depthwise output at ``i * pointwise stride``, input windows of the depthwise convolution
+        are ``depthwise stride * pointwise stride`` apart. The line buffer holds the depthwise output read by a row of output
+        for Conv2D, blocks of output positions for Conv1D, as many as the scratch size allows.
+        """
+        if not isinstance(node.layer, TSeparableConvLayer) or node.q.width is None:
+            return {}
+        depthwise = node.layer.depthwise
+        pointwise = node.layer.pointwise
+        if not isinstance(depthwise.layer, (TConv1DLayer, TConv2DLayer)) \
+                or not isinstance(pointwise.layer, (TConv1DLayer, TConv2DLayer)):
+            return {}
+
+        strides = [ds * ps for ds, ps in zip(depthwise.layer.strides, pointwise.layer.strides)]
+
+        if isinstance(node.layer, TSeparableConv2DLayer):
+            line = node.output_shape[0][-2]
+        else:
+            line = self.conv_scratch_size // (depthwise.layer.filters * math.ceil(node.q.width / 8))
+            line = min(max(line, self.conv_tile_x), node.output_shape[0][-2])
+
+        return {'depthwise': self.depthwise_options(depthwise),
+                'tile': self.tile_options(pointwise),
+                'strides': strides,
+                'interior': self.__interior(node.input_shape[0][1:-1],
+                                            node.output_shape[0][1:-1],
+                                            depthwise.layer.kernel_size,
+                                            strides,
+                                            self.__padding(depthwise)[::2]),
+                'line': line}
+
+    def interior_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute range of output positions along each spatial dimension whose receptive field is entirely inside input.
+
+        Outside of this range, output positions are computed by the border loop nest that handles padding.
+        """
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {}
+
+        return self.__interior(node.input_shape[0][1:-1],
+                               node.output_shape[0][1:-1],
+                               node.layer.kernel_size,
+                               node.layer.strides,
+                               self.__padding(node)[::2])
+
+    def __interior(self,
+                   input_sizes: tuple[int, ...],
+                   output_sizes: tuple[int, ...],
+                   kernel_sizes: tuple[int, ...],
+                   strides: tuple[int, ...] | list[int],
+                   padding_before: tuple[int, ...]) -> dict[str, Any]:
+        start: list[int] = []
+        end: list[int] = []
+        for input_size, output_size, kernel_size, stride, padding in zip(input_sizes,
+                                                                         output_sizes,
+                                                                         kernel_sizes,
+                                                                         strides,
+                                                                         padding_before):
+            # First position with window starting inside input
+            start.append(min(math.ceil(padding / stride), output_size))
+            # Last position with window ending inside input, + 1
+            last = (input_size + padding - kernel_size) // stride + 1 if input_size + padding >= kernel_size else 0
+            end.append(max(start[-1], min(last, output_size)))
+
+        return {'start': start, 'end': end}
+
+    def winograd_options(self, node: LayerNode) -> dict[str, Any]:
+        """Compute Winograd F(m, 3) or F(m x m, 3 x 3) parameters of a convolution layer.
+
+        Float layers use F(4, 3) for Conv1D. Fixed-point layers use F(2, 3) and F(2 x 2, 3 x 3) whose transforms are scaled
+        to integers by 2 per dimension, keeping the growth of the transformed operands in the 32-bit accumulator small.
+        Result of the output transform is divided by ``scale`` to compensate.
+        """
+        if not isinstance(node.layer, (TConv1DLayer, TConv2DLayer)) or node.q.long_width is None:
+            return {}
+
+        dims = len(node.layer.kernel_size)
+        m = 4 if dims == 1 and node.q.number_type is float else 2
+        alpha = m + 2
+        tiles = [math.ceil(size / m) for size in node.output_shape[0][1:-1]]
+        points = alpha ** dims
+        g_scale = 1 if node.q.number_type is float else math.lcm(*(g.denominator for row in self.winograd_g[m] for g in row))
+
+        # Transformed input of a block of tiles, as many as the scratch size allows, at least one
+        block = self.conv_scratch_size // (points * node.input_shape[0][-1] * math.ceil(node.q.long_width / 8))
+        block = min(max(block, 1), math.prod(tiles))
+
+        return {'m': m,
+                'alpha': alpha,
+                'points': points,
+                'tiles': tiles,
+                'block': block,
+                'g_scale': g_scale,
+                'scale': g_scale ** dims,
+                'bt': self.winograd_bt[m],
+                'at': self.winograd_at[m]}
+
+    def macs(self, node: LayerNode) -> int:
+        """Estimate the number of multiply-accumulate operations of a layer.
+
+        Comparisons or additions of pooling layers are counted instead for pooling layers, one operation per output element for
+        other layers.
+        """
+        if isinstance(node.layer, TSeparableConvLayer):
+            return self.macs(node.layer.depthwise) + self.macs(node.layer.pointwise)
+        outputs = math.prod(node.output_shape[0][1:])
+        if isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return outputs * math.prod(node.layer.kernel_size) * node.input_shape[0][-1] // node.layer.groups
+        if isinstance(node.layer, TDenseLayer):
+            return outputs * node.input_shape[0][-1]
+        if isinstance(node.layer, (TMaxPoolingLayer, TAvgPoolingLayer)):
+            return outputs * math.prod(node.layer.pool_size)
+        return outputs
+
+    def parallel_options(self, node: LayerNode, options: dict[str, Any]) -> dict[str, Any]:
+        """Compute how the output of a layer is split across threads: ``n`` elements in chunks of ``grain`` elements.
+
+        Convolutions split output rows (Conv2D) or positions by tiles (Conv1D) of the direct and depthwise engines, the im2col
+        and Winograd engines share their scratch buffer and are not split. Fully-connected layers split panels of units and
+        pooling layers split channels. Layers with fewer than :attr:`parallel_min_ops` operations are not split.
+        """
+        if isinstance(node.layer, (TConv1DLayer, TConv2DLayer)) and options['conv_engine'] in ('direct', 'depthwise'):
+            if isinstance(node.layer, TConv2DLayer):
+                n, grain = node.output_shape[0][-3], 1
+            else:
+                n, grain = node.output_shape[0][-2], options['tile']['x']
+        elif isinstance(node.layer, TDenseLayer) and 'fc' in options:
+            n, grain = options['fc']['panels'], 1
+        elif isinstance(node.layer, (TMaxPoolingLayer, TAvgPoolingLayer)):
+            n = node.input_shape[0][-1]
+            grain = self.parallel_channel_grain if isinstance(node.layer, TMaxPooling1DLayer) else 1
+        else:
+            return {}
+
+        if self.macs(node) < self.parallel_min_ops or n <= grain:
+            return {}
+
+        logger.info('Splitting "%s" across threads: %d elements in chunks of %d', node.layer.name, n, grain)
+        return {'n': n, 'grain': grain}
+
+    def scratch(self, node: LayerNode, options: dict[str, Any]) -> bool:
+        """Check whether the kernels of a layer use scratch buffers, they are then allocated in the model context.
+
+        Portable kernels use the im2col or Winograd buffer of convolutions, the accumulators of blocked fully-connected layers,
+        the line buffer of fused separable convolutions and the accumulators of MaxPool1D and Sum. CMSIS-NN/NMSIS-NN functions
+        of 8-bit and 16-bit convolution and fully-connected layers use ``bufferA``.
+        """
+        if isinstance(node.layer, (TMaxPooling1DLayer, TSumLayer, TSeparableConvLayer)):
+            return True
+        cmsis = node.q.number_type is int and node.q.width in (8, 16)
+        if isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return (cmsis
+                    or options['conv_engine'] == 'winograd'
+                    or (options['conv_engine'] == 'im2col' and options['gemm']['im2col']))
+        if isinstance(node.layer, TDenseLayer):
+            return cmsis or ('input_block' in options['fc'] and options['fc']['input_block'] < node.input_shape[0][-1])
+        return False
+
+    def select(self,
+               node: LayerNode,
+               stream_shift: int = 0,
+               rows_update: bool = False,  # noqa: FBT001, FBT002
+               sequence: bool = False) -> dict[str, Any]:  # noqa: FBT001, FBT002
+        """Select the kernel implementation of a layer.
+
+        :param node: Layer to generate
+        :param stream_shift: Number of output positions shifted by each cnn_push() call for layers streamed over a sliding
+            window, only the last positions are computed; 0 if the layer is not streamed
+        :param rows_update: Layer recomputed by cnn_update() on a range of output rows
+        :param sequence: Layer computed by cnn_sequence() on the valid length of a shorter input
+        """
+        options: dict[str, Any] = {}
+
+        if isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            options['conv_engine'] = self.conv_engine(node, partial=stream_shift > 0 or rows_update or sequence)
+            if options['conv_engine'] == 'im2col':
+                options['gemm'] = self.gemm_options(node)
+                logger.info('Using im2col + GEMM engine for "%s": %s', node.layer.name, options['gemm'])
+            elif options['conv_engine'] == 'winograd':
+                options['winograd'] = self.winograd_options(node)
+                macs = math.prod(options['winograd']['tiles']) * options['winograd']['points'] * node.input_shape[0][-1]
+                logger.info('Using Winograd F(%s, 3) for "%s": %d multiplications per filter instead of %d',
+                            options['winograd']['m'],
+                            node.layer.name,
+                            macs,
+                            math.prod(node.output_shape[0][1:-1]) * math.prod(node.layer.kernel_size) * node.input_shape[0][-1])
+            else:
+                options['tile'] = self.tile_options(node)
+                options['interior'] = self.interior_options(node)
+                if options['conv_engine'] == 'depthwise':
+                    options['depthwise'] = self.depthwise_options(node)
+        elif isinstance(node.layer, TDenseLayer):
+            options['fc'] = self.fc_options(node)
+        elif isinstance(node.layer, TSeparableConvLayer):
+            options = self.separable_options(node)
+            logger.info('Using fused separable convolution for "%s": line buffer of %d positions',
+                        node.layer.name,
+                        options['line'])
+
+        options['parallel'] = self.parallel_options(node, options)
+        options['scratch'] = self.scratch(node, options)
+        options['macs'] = self.macs(node)
+        options['stream'] = {'shift': stream_shift} if stream_shift > 0 else {}
+        options['update'] = rows_update
+        options['sequence'] = sequence
+
+        return options
+
+    def pack_gemm_kernel(self, kernel: NDArrayFloatOrInt, panels: int, nr: int) -> NDArrayFloatOrInt:
+        """Pack kernel in panels of ``nr`` filters so that the GEMM microkernel loads ``nr`` contiguous weights per step.
+
+        :param kernel: Kernel of shape ``(filters, …)``, receptive field is flattened
+        :param panels: Number of panels, last panel is zero-padded if filters is not a multiple of ``nr``
+        :param nr: Number of filters per panel
+        :return: Packed kernel of shape ``(panels, K, nr)``
+        """
+        kernel = kernel.reshape(kernel.shape[0], -1)
+        padded = np.zeros((panels * nr, kernel.shape[1]), dtype=kernel.dtype)
+        padded[:kernel.shape[0]] = kernel
+        packed: NDArrayFloatOrInt = padded.reshape(panels, nr, kernel.shape[1]).transpose(0, 2, 1)
+        return packed
+
+    def pack_fc_kernel(self, kernel: NDArrayFloatOrInt, panels: int, tile: int) -> NDArrayFloatOrInt:
+        """Pack kernel in panels of ``tile`` units, the rows of a panel are read together in one pass over the input.
+
+        Samples stay innermost so that each unit is a contiguous dot product with the input, which vectorizes as a widening
+        multiply-add reduction, whereas interleaving units for each sample requires a full-width multiply per sample.
+
+        :param kernel: Kernel of shape ``(units, samples)``
+        :param panels: Number of panels, last panel is zero-padded if units is not a multiple of ``tile``
+        :param tile: Number of units per panel
+        :return: Packed kernel of shape ``(panels, tile, samples)``
+        """
+        padded = np.pad(kernel, ((0, panels * tile - kernel.shape[0]), (0, 0)))
+        packed: NDArrayFloatOrInt = np.reshape(padded, (panels, tile, kernel.shape[1]))
+        return packed
+
+    def depthwise_kernel(self, kernel: NDArrayFloatOrInt) -> NDArrayFloatOrInt:
+        """Move filters innermost so that the depthwise kernel reads contiguous channels for each tap.
+
+        :param kernel: Kernel of shape ``(filters, …, 1)``
+        :return: Kernel of shape ``(…, filters)``
+        """
+        depthwise: NDArrayFloatOrInt = np.moveaxis(kernel[..., 0], 0, -1).copy()
+        return depthwise
+
+    def winograd_kernel(self, node: LayerNode, kernel: NDArrayFloatOrInt, winograd: dict[str, Any]) -> NDArrayFloatOrInt:
+        """Apply Winograd filter transform ``G kernel G^T`` (``G kernel`` for Conv1D) to each filter and channel.
+
+        Fixed-point kernel is transformed with ``G`` scaled to integers and stored with the width of the accumulator.
+
+        :param kernel: Kernel of shape ``(filters, 3, channels)`` or ``(filters, 3, 3, channels)``
+        :return: Transformed kernel of shape ``(filters, points, channels)``, points are ordered ``[alpha][alpha]`` for Conv2D
+        """
+        g = np.array(self.winograd_g[winograd['m']], dtype=np.float64)
+        if node.q.number_type is float:
+            dtype: np.dtype[Any] = kernel.dtype
+        else:
+            g = g * winograd['g_scale']
+            dtype = np.dtype(f'int{node.q.long_width}')
+
+        if kernel.ndim == 4:  # noqa: PLR2004 # Conv2D [F][KY][KX][C]
+            transformed = np.einsum('ay,fyxc,bx->fabc', g, kernel.astype(np.float64), g)
+        else:  # Conv1D [F][K][C]
+            transformed = np.einsum('ax,fxc->fac', g, kernel.astype(np.float64))
+
+        if node.q.number_type is not float:
+            transformed = np.rint(transformed)
+            if np.abs(transformed).max(initial=0) > np.iinfo(dtype).max:
+                logger.warning('Winograd transformed kernel of "%s" overflows %s', node.layer.name, dtype)
+
+        packed: NDArrayFloatOrInt = transformed.astype(dtype).reshape(kernel.shape[0], winograd['points'], kernel.shape[-1])
+        return packed
+
+    def pack_weights(self, node: LayerNode, options: dict[str, Any]) -> dict[str, NDArrayFloatOrInt]:
+        """Transform weights at code generation time to the layout expected by the selected kernel implementation."""
+        if options.get('conv_engine') == 'im2col' and isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {'kernel': self.pack_gemm_kernel(node.layer.kernel, options['gemm']['panels'], options['gemm']['nr'])}
+        if options.get('conv_engine') == 'winograd' and isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {'kernel': self.winograd_kernel(node, node.layer.kernel, options['winograd'])}
+        if options.get('conv_engine') == 'depthwise' and isinstance(node.layer, (TConv1DLayer, TConv2DLayer)):
+            return {'kernel': self.depthwise_kernel(node.layer.kernel)}
+        if 'fc' in options and isinstance(node.layer, TDenseLayer):
+            return {'kernel': self.pack_fc_kernel(node.layer.kernel, options['fc']['panels'], options['fc']['tile'])}
+        if isinstance(node.layer, TSeparableConvLayer):
+            weights = node.layer.weights
+            # Pointwise kernel [F][1…][C] to [F][C]
+            return {'depthwise_kernel': self.depthwise_kernel(weights['depthwise_kernel']),
+                    'kernel': weights['kernel'].reshape(weights['kernel'].shape[0], -1)}
+        return {}
@@ -71,7 +71,7 @@
         {%- if node.layer.__class__.__name__ == 'TInputLayer' -%} // Model input is passed as model parameter
           input
         {%- elif node != nodes[-1] -%}
-          activations{{ allocation.index[node] }}.{{ node.layer.name }}_output
+          ctx->activations{{ allocation.index[node] }}.{{ node.layer.name }}_output
         {%- else -%} // Last layer uses output passed as model parameter
           {{ node.layer.name }}_output
         {%- endif %}
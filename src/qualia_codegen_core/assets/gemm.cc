@@ -0,0 +1,147 @@
+{#
+  im2col + packed GEMM engine shared by the portable path of convolution layers.
+
+  Output is computed as output[M][N] = A[M][K] * kernel[N][K]^T with M the number of output positions, N the number of filters
+  and K the size of the receptive field. Rows of A are either the im2col buffer or read directly from the input.
+  The kernel is packed at code generation time in GEMM_PANELS panels of GEMM_NR filters: kernel[GEMM_PANELS][GEMM_K][GEMM_NR].
+  Macros expect the layer template to define CONV_FILTERS, NUMBER_T, LONG_NUMBER_T and the fixed-point scale factors.
+  The epilogue macro (bias, activation and fixed-point scaling of an accumulator) is also used by the direct convolutions and
+  the fused separable convolutions, tile_epilogue applies it to a row of a tile of accumulators.
+#}
+
+{% macro defines(gemm) %}
+#define GEMM_MR             {{ gemm.mr }}
+#define GEMM_NR             {{ gemm.nr }}
+#define GEMM_M              {{ gemm.m }}
+#define GEMM_K              {{ gemm.k }}
+#define GEMM_PANELS         {{ gemm.panels }}
+#define IM2COL_ROWS         {{ gemm.rows }}
+{% endmacro %}
+
+{% macro undefs() %}
+#undef GEMM_MR
+#undef GEMM_NR
+#undef GEMM_M
+#undef GEMM_K
+#undef GEMM_PANELS
+#undef IM2COL_ROWS
+{% endmacro %}
+
+{% macro variables() %}
+  unsigned int m, t, i, j, p, k, mr, nr;
+  const NUMBER_T *a;
+  const NUMBER_T *b;
+  LONG_NUMBER_T acc[GEMM_MR][GEMM_NR];
+  LONG_NUMBER_T output_acc;
+{% endmacro %}
+
+{% macro epilogue(node, out, bias_index='k') %}
+            // Scale for possible additional precision of bias
+            output_acc = scale(NUMBER_T, output_acc, WEIGHTS_SCALE_FACTOR - TMP_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+{% if node.layer.use_bias is not defined or node.layer.use_bias %}{# BatchNorm always has a bias #}
+            // Scale bias to match accumulator
+            output_acc += scale(NUMBER_T, (LONG_NUMBER_T)bias[{{ bias_index }}], BIASES_SCALE_FACTOR - TMP_SCALE_FACTOR - INPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+{% endif %}
+
+#ifdef ACTIVATION_LINEAR
+            {{ out }} = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+#elif defined(ACTIVATION_RELU) || defined(ACTIVATION_RELU6)
+            // Activation function: ReLU
+            if (output_acc < 0) {
+              {{ out }} = 0;
+            } else {
+#if defined(ACTIVATION_RELU6)
+              if (output_acc > scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE)) {
+                output_acc = scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE);
+              }
+#endif
+              {{ out }} = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+            }
+#else
+#error "Unsupported activation function"
+#endif
+{% endmacro %}
+
+{#
+  Epilogue of the accumulators acc[0, n) of a row of a tile to the contiguous outputs out_row[0, n), n is at most the constant
+  n_max, out is the output of accumulator j and bias_index its bias. The x86 SIMD backend applies bias and activation to the
+  accumulators in place, then scales and saturates the whole row with vector instructions.
+#}
+{% macro tile_epilogue(node, acc, n, n_max, out_row, out, bias_index='k + j') %}
+#ifdef WITH_X86_SIMD
+            for (j = 0; j < {{ n }}; j++) {
+              output_acc = {{ acc }}[j];
+              // Scale for possible additional precision of bias
+              output_acc = scale(NUMBER_T, output_acc, WEIGHTS_SCALE_FACTOR - TMP_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+{% if node.layer.use_bias is not defined or node.layer.use_bias %}
+              // Scale bias to match accumulator
+              output_acc += scale(NUMBER_T, (LONG_NUMBER_T)bias[{{ bias_index }}], BIASES_SCALE_FACTOR - TMP_SCALE_FACTOR - INPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+{% endif %}
+#if defined(ACTIVATION_RELU) || defined(ACTIVATION_RELU6)
+              // Activation function: ReLU, 0 stays 0 once scaled
+              if (output_acc < 0) {
+                output_acc = 0;
+              }
+#if defined(ACTIVATION_RELU6)
+              if (output_acc > scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE)) {
+                output_acc = scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE);
+              }
+#endif
+#elif !defined(ACTIVATION_LINEAR)
+#error "Unsupported activation function"
+#endif
+              {{ acc }}[j] = output_acc;
+            }
+            scale_and_clamp_to_n(NUMBER_T, {{ acc }}, {{ out_row }}, {{ n }}, {{ n_max }}, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+#else
+            for (j = 0; j < {{ n }}; j++) {
+              output_acc = {{ acc }}[j];
+{{ epilogue(node, out, bias_index) | indent(2, true) }}
+            }
+#endif
+{%- endmacro %}
+
+{#
+  Compute output rows [row, row + rows) from A rows of stride lda.
+#}
+{% macro block(node, a_rows, lda, rows, row, output) %}
+    for (m = 0; m < {{ rows }}; m += GEMM_MR) {
+      a = {{ a_rows }} + m * {{ lda }};
+      mr = {{ rows }} - m < GEMM_MR ? {{ rows }} - m : GEMM_MR;
+
+      for (p = 0; p < GEMM_PANELS; p++) {
+        b = kernel[p][0];
+
+        for (i = 0; i < GEMM_MR; i++) {
+          for (j = 0; j < GEMM_NR; j++) {
+            acc[i][j] = 0;
+          }
+        }
+
+        // Microkernel: GEMM_MR x GEMM_NR accumulators kept in registers, one broadcast input and GEMM_NR contiguous weights per step
+        if (mr == GEMM_MR) {
+          for (t = 0; t < GEMM_K; t++) {
+            for (i = 0; i < GEMM_MR; i++) {
+              for (j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += (LONG_NUMBER_T)a[i * {{ lda }} + t] * (LONG_NUMBER_T)b[t * GEMM_NR + j];
+              }
+            }
+          }
+        } else { // Remaining rows
+          for (t = 0; t < GEMM_K; t++) {
+            for (i = 0; i < mr; i++) {
+              for (j = 0; j < GEMM_NR; j++) {
+                acc[i][j] += (LONG_NUMBER_T)a[i * {{ lda }} + t] * (LONG_NUMBER_T)b[t * GEMM_NR + j];
+              }
+            }
+          }
+        }
+
+        k = p * GEMM_NR;
+        nr = CONV_FILTERS - k < GEMM_NR ? CONV_FILTERS - k : GEMM_NR;
+        for (i = 0; i < mr; i++) {
+{{ tile_epilogue(node, 'acc[i]', 'nr', 'GEMM_NR', '&' ~ output ~ '[' ~ row ~ ' + m + i][k]', output ~ '[' ~ row ~ ' + m + i][k + j]') }}
+        }
+      }
+    }
+{% endmacro %}
@@ -7,6 +7,7 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'scratch.cc' as scratch with context %}
 #ifndef _{{ node.layer.name | upper }}_H_
 #define _{{ node.layer.name | upper }}_H_
 
@@ -29,6 +30,10 @@
 #define CONV_OUTSAMPLES     ( ( (INPUT_SAMPLES - CONV_KERNEL_SIZE + ZEROPADDING_LEFT + ZEROPADDING_RIGHT) / CONV_STRIDE ) + 1 )
 
 typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[CONV_OUTSAMPLES][CONV_FILTERS];
+{% if options.scratch %}
+
+{{ scratch.conv_typedef(node, options, '2*INPUT_CHANNELS*CONV_KERNEL_SIZE') }}
+{% endif %}
 
 #if 0
 void {{ node.layer.name }}(
@@ -7,6 +7,7 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'scratch.cc' as scratch with context %}
 #ifndef _{{ node.layer.name | upper }}_H_
 #define _{{ node.layer.name | upper }}_H_
 
@@ -38,6 +39,10 @@
 
 
 typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS];
+{% if options.scratch %}
+
+{{ scratch.conv_typedef(node, options, 'INPUT_HEIGHT*INPUT_WIDTH*INPUT_CHANNELS') }}
+{% endif %}
 
 #if 0
 void {{ node.layer.name }}(
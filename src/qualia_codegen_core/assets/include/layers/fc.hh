@@ -7,6 +7,7 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'scratch.cc' as scratch with context %}
 #ifndef _{{ node.layer.name | upper }}_H_
 #define _{{ node.layer.name | upper }}_H_
 
@@ -19,6 +20,17 @@
 #define FC_UNITS {{ node.layer.units }}
 
 typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[FC_UNITS];
+{% if options.scratch %}
+{% set long_number_t = qtype2ctype(node.q.number_type, node.q.long_width) %}
+{% if options.fc.input_block < node.input_shape[0][-1] %}
+{% set portable = [long_number_t ~ ' acc[' ~ options.fc.panels ~ '][' ~ options.fc.tile ~ ']',
+                   long_number_t ~ ' batch_acc[' ~ options.fc.panels ~ '][' ~ options.fc.batch_tile ~ '][' ~ options.fc.tile ~ ']'] %}
+{% else %}
+{% set portable = [] %}
+{% endif %}
+
+{{ scratch.typedef(node, portable, ['int16_t bufferA[INPUT_SAMPLES]'] if node.q.number_type.__name__ == 'int' and node.q.width in [8, 16] else []) }}
+{% endif %}
 
 #if 0
 void {{ node.layer.name }}(
@@ -7,6 +7,7 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'scratch.cc' as scratch with context %}
 #ifndef _{{ node.layer.name | upper }}_H_
 #define _{{ node.layer.name | upper }}_H_
 
@@ -23,6 +24,9 @@
 
 typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[POOL_LENGTH][INPUT_CHANNELS];
 
+{% set buffers = [qtype2ctype(node.q.number_type, node.q.long_width) ~ ' max[INPUT_CHANNELS]'] %}
+{{ scratch.typedef(node, buffers, buffers) }}
+
 #if 0
 void {{ node.layer.name }}(
   const number_t input[INPUT_SAMPLES][INPUT_CHANNELS], 	    // IN
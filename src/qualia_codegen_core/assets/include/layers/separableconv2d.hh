@@ -0,0 +1,32 @@
+/**
+  ******************************************************************************
+  * @file    separableconv2d.hh
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version V2.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+{% import 'scratch.cc' as scratch with context %}
+#ifndef _{{ node.layer.name | upper }}_H_
+#define _{{ node.layer.name | upper }}_H_
+
+#ifndef SINGLE_FILE
+#include "number.h"
+#endif
+
+#define CONV_FILTERS        {{ node.layer.pointwise.layer.filters }}
+#define CONV_OUTHEIGHT      {{ node.output_shape[0][-3] }}
+#define CONV_OUTWIDTH       {{ node.output_shape[0][-2] }}
+
+typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS];
+
+// Line buffer: the depthwise output is never stored whole, only the positions read by the current output row
+{% set buffers = [qtype2ctype(node.q.number_type, node.q.width) ~ ' line[CONV_OUTWIDTH][' ~ node.layer.depthwise.layer.filters ~ ']'] %}
+{{ scratch.typedef(node, buffers, buffers) }}
+
+#undef CONV_FILTERS
+#undef CONV_OUTHEIGHT
+#undef CONV_OUTWIDTH
+
+#endif//_{{ node.layer.name | upper }}_H_
@@ -7,6 +7,7 @@
   * @brief   Global Sum Pooling
   */
 
+{% import 'scratch.cc' as scratch with context %}
 #ifndef _{{ node.layer.name | upper }}_H_
 #define _{{ node.layer.name | upper }}_H_
 
@@ -24,6 +25,9 @@
 
 typedef {{ qtype2ctype(node.q.number_type, node.q.width) }} {{ node.layer.name }}_output_type[INPUT_CHANNELS];
 
+{% set buffers = [qtype2ctype(node.q.number_type, node.q.long_width) ~ ' output_acc[INPUT_CHANNELS]'] %}
+{{ scratch.typedef(node, buffers, buffers) }}
+
 #if 0
 void {{ node.layer.name }}(
 {% if node.input_shape[0] | length == 3 %}
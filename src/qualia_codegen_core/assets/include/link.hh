@@ -0,0 +1,281 @@
+/**
+  ******************************************************************************
+  * @file    link.hh
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version 1.0.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __LINK_H__
+#define __LINK_H__
+
+/* Link between the head and tail packages of a split model: the output of {{ node.layer.name }} computed by the head is sent to
+ * the tail in a frame of bytes, independent of the endianness of both sides.
+ *
+ * Frame header, multi-byte fields in little-endian order:
+ *   0-1  magic "QL"
+ *   2    flags, LINK_RLE if the payload is run-length encoded
+ *   3    width in bytes of each element
+ *   4    scale factor of the elements (signed)
+ *   5-7  size of the payload in bytes
+ * The payload holds the LINK_ELEMENTS elements of the tensor in little-endian order. With run-length encoding, each zero element
+ * is followed by a byte counting the next zero elements (up to 255) it stands for, so that the zeros of a ReLU output cost
+ * little. link_encode() falls back to the raw payload when it is not smaller. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LINK_ELEMENTS ({{ node.output_shape[0][1:] | join(' * ') }})
+#define LINK_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
+#define LINK_UINT_T uint{{ node.q.width }}_t
+#define LINK_WIDTH {{ node.q.width // 8 }}
+#define LINK_SCALE_FACTOR {{ node.q.output_scale_factor or 0 }}
+#define LINK_HEADER_SIZE 8
+#define LINK_FRAME_SIZE (LINK_HEADER_SIZE + LINK_ELEMENTS * LINK_WIDTH) // Largest frame, with the raw payload
+#define LINK_RLE 0x01
+
+static inline void link_put(unsigned char *p, LINK_NUMBER_T v) {
+  LINK_UINT_T bits;
+  memcpy(&bits, &v, sizeof(bits));
+  for (size_t b = 0; b < LINK_WIDTH; b++) {
+    p[b] = (unsigned char)(bits >> (8 * b));
+  }
+}
+
+static inline LINK_NUMBER_T link_get(const unsigned char *p) {
+  LINK_UINT_T bits = 0;
+  LINK_NUMBER_T v;
+  for (size_t b = 0; b < LINK_WIDTH; b++) {
+    bits |= (LINK_UINT_T)((LINK_UINT_T)p[b] << (8 * b));
+  }
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static inline int link_is_zero(LINK_NUMBER_T v) {
+  LINK_UINT_T bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits == 0;
+}
+
+// Run-length encoded payload, 0 if it would not be smaller than the raw payload
+static inline size_t link_encode_rle(const LINK_NUMBER_T tensor[LINK_ELEMENTS], unsigned char *payload) {
+  size_t size = 0;
+
+  for (size_t i = 0; i < LINK_ELEMENTS; i++) {
+    if (size + LINK_WIDTH + 1 > LINK_ELEMENTS * LINK_WIDTH) {
+      return 0;
+    }
+    link_put(&payload[size], tensor[i]);
+    size += LINK_WIDTH;
+    if (link_is_zero(tensor[i])) {
+      unsigned char run = 0;
+      while (run < 255 && i + 1 < LINK_ELEMENTS && link_is_zero(tensor[i + 1])) {
+        run++;
+        i++;
+      }
+      payload[size++] = run;
+    }
+  }
+  return size;
+}
+
+// Writes the frame of tensor, run-length encoded if rle is non-zero, returns its size
+static inline size_t link_encode(const LINK_NUMBER_T tensor[LINK_ELEMENTS], unsigned char frame[LINK_FRAME_SIZE], int rle) {
+  unsigned char *payload = &frame[LINK_HEADER_SIZE];
+  size_t size = rle ? link_encode_rle(tensor, payload) : 0;
+
+  frame[2] = size ? LINK_RLE : 0;
+  if (!size) {
+    for (size_t i = 0; i < LINK_ELEMENTS; i++) {
+      link_put(&payload[i * LINK_WIDTH], tensor[i]);
+    }
+    size = LINK_ELEMENTS * LINK_WIDTH;
+  }
+
+  frame[0] = 'Q';
+  frame[1] = 'L';
+  frame[3] = LINK_WIDTH;
+  frame[4] = (unsigned char)(signed char)LINK_SCALE_FACTOR;
+  frame[5] = (unsigned char)size;
+  frame[6] = (unsigned char)(size >> 8);
+  frame[7] = (unsigned char)(size >> 16);
+  return LINK_HEADER_SIZE + size;
+}
+
+// Size of the payload announced by a frame header, 0 if the header does not match this link
+static inline size_t link_payload_size(const unsigned char header[LINK_HEADER_SIZE]) {
+  size_t size = (size_t)header[5] | (size_t)header[6] << 8 | (size_t)header[7] << 16;
+
+  if (header[0] != 'Q' || header[1] != 'L' || (header[2] & ~LINK_RLE) || header[3] != LINK_WIDTH
+      || (signed char)header[4] != LINK_SCALE_FACTOR || size > LINK_ELEMENTS * LINK_WIDTH) {
+    return 0;
+  }
+  return size;
+}
+
+// Reads the tensor of a frame, returns 0 on success or -1 if the frame is malformed
+static inline int link_decode(const unsigned char *frame, size_t size, LINK_NUMBER_T tensor[LINK_ELEMENTS]) {
+  const unsigned char *payload = &frame[LINK_HEADER_SIZE];
+  size_t payload_size;
+  size_t p = 0;
+
+  if (size < LINK_HEADER_SIZE) {
+    return -1;
+  }
+  payload_size = link_payload_size(frame);
+  if (!payload_size || payload_size != size - LINK_HEADER_SIZE) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < LINK_ELEMENTS; i++) {
+    if (p + LINK_WIDTH > payload_size) {
+      return -1;
+    }
+    tensor[i] = link_get(&payload[p]);
+    p += LINK_WIDTH;
+    if ((frame[2] & LINK_RLE) && link_is_zero(tensor[i])) {
+      if (p >= payload_size || i + payload[p] >= LINK_ELEMENTS) {
+        return -1;
+      }
+      for (unsigned char run = payload[p++]; run > 0; run--) {
+        i++;
+        tensor[i] = tensor[i - 1];
+      }
+    }
+  }
+  return p == payload_size ? 0 : -1;
+}
+
+/* Reference transport over a pipe or a Unix domain socket for hosts, frames are self-delimited by their header.
+ * Define LINK_NO_TRANSPORT to only keep the frame codec. */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(LINK_NO_TRANSPORT)
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef LINK_CONNECT_RETRIES
+#define LINK_CONNECT_RETRIES 50 // Attempts of link_connect() 100 ms apart while the socket is not listening yet
+#endif
+
+// Writes a frame to fd, returns 0 on success or -1 on error
+static inline int link_send(int fd, const unsigned char *frame, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, frame, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    frame += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
+
+// Reads exactly size bytes, returns 1 on success, 0 at the end of the stream before the first byte or -1 on error
+static inline int link_read(int fd, unsigned char *buf, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = read(fd, &buf[done], size - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 || (n == 0 && done > 0)) {
+      return -1;
+    }
+    if (n == 0) {
+      return 0;
+    }
+    done += (size_t)n;
+  }
+  return 1;
+}
+
+// Reads the next frame from fd, returns its size, 0 at the end of the stream or -1 on error or malformed header
+static inline long link_receive(int fd, unsigned char frame[LINK_FRAME_SIZE]) {
+  size_t size;
+  int r = link_read(fd, frame, LINK_HEADER_SIZE);
+
+  if (r <= 0) {
+    return r;
+  }
+  size = link_payload_size(frame);
+  if (!size || link_read(fd, &frame[LINK_HEADER_SIZE], size) != 1) {
+    return -1;
+  }
+  return (long)(LINK_HEADER_SIZE + size);
+}
+
+static inline int link_address(const char *path, struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    return -1;
+  }
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+// Waits for the other side to connect to the Unix domain socket at path, returns the connected descriptor or -1 on error
+static inline int link_listen(const char *path) {
+  struct sockaddr_un addr;
+  int server;
+  int fd;
+
+  if (link_address(path, &addr) < 0 || (server = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    return -1;
+  }
+  unlink(path);
+  if (bind(server, (const struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server, 1) < 0) {
+    close(server);
+    return -1;
+  }
+  do {
+    fd = accept(server, NULL, NULL);
+  } while (fd < 0 && errno == EINTR);
+  close(server);
+  unlink(path);
+  return fd;
+}
+
+// Connects to the Unix domain socket at path, returns the connected descriptor or -1 on error
+static inline int link_connect(const char *path) {
+  const struct timespec delay = { 0, 100000000 };
+  struct sockaddr_un addr;
+
+  if (link_address(path, &addr) < 0) {
+    return -1;
+  }
+  for (int attempt = 0; attempt < LINK_CONNECT_RETRIES; attempt++) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+      return -1;
+    }
+    if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) == 0) {
+      return fd;
+    }
+    close(fd);
+    if (errno != ENOENT && errno != ECONNREFUSED) {
+      return -1;
+    }
+    nanosleep(&delay, NULL);
+  }
+  return -1;
+}
+#endif
+
+#endif//__LINK_H__
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
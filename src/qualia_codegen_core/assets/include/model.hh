@@ -35,6 +35,13 @@ extern "C" {
 #define MODEL_INPUT_NUMBER_T {{ qtype2ctype(nodes[0].q.number_type, nodes[0].q.width) }}
 #define MODEL_INPUT_LONG_NUMBER_T {{ qtype2ctype(nodes[0].q.number_type, nodes[0].q.long_width) }}
 
+// Maximum number of samples processed by each layer at once in cnn_batch(), activations are allocated for this number of samples
+#define MODEL_MAX_BATCH {{ allocation.max_batch }}
+#define MODEL_LAYERS {{ nodes | length - 1 }} // InputLayer excluded
+{% if schedule.stream %}
+#define MODEL_STREAM_HOP {{ schedule.stream.hop }} // New input samples of each cnn_push()
+{% endif %}
+
 #define MODEL_OUTPUT_SCALE_FACTOR {{ nodes[-1].q.output_scale_factor }} // scale factor of last layer
 #define MODEL_OUTPUT_ROUND_MODE ROUND_MODE_{{ nodes[-1].q.output_round_mode | upper }}
 #define MODEL_OUTPUT_NUMBER_T {{ qtype2ctype(nodes[-1].q.number_type, nodes[0].q.width) }}
@@ -44,12 +51,183 @@ extern "C" {
 // typedef {{ number_type }} input_t{% for dim in nodes[0].output_shape[0][1:] %}[{{ dim }}]{% endfor %};
 typedef {{ qtype2ctype(nodes[0].q.number_type, nodes[0].q.width) }} input_t{% for dim in nodes[0].output_shape[0][1:] %}[{{ dim }}]{% endfor %};
 typedef {{ nodes[-1].layer.name }}_output_type output_t;
+{% if schedule.stream %}
+typedef {{ qtype2ctype(nodes[0].q.number_type, nodes[0].q.width) }} sample_t[{{ nodes[0].output_shape[0][-1] }}];
+{% endif %}
+
+{#
+  Member of the activations for the output of node, placed at its offset in the memory it shares with other layers
+#}
+{% macro output(node) -%}
+{%- if allocation.placement[node] -%}
+struct { unsigned char {{ node.layer.name }}_offset[{{ allocation.placement[node] }}]; {{ node.layer.name }}_output_type {{ node.layer.name }}_output; };
+{%- else -%}
+{{ node.layer.name }}_output_type {{ node.layer.name }}_output{{ '[MODEL_MAX_BATCH]' if allocation.max_batch > 1 }};
+{%- endif -%}
+{%- endmacro %}
+
+// Activations and scratch buffers of the layers, each concurrent inference needs its own context. A context may be allocated
+// by the caller in any memory aligned for its members, for example with malloc(cnn_ctx_size()).
+typedef struct {
+{%- if allocation.offsets %}
+  // Arena of {{ allocation.arena }} bytes (at least {{ allocation.lower_bound }} bytes are live at once), each pool of activations is
+  // placed at its planned offset and overlaps the pools that are never live at the same time
+  union {
+  {%- for pool in allocation.pools %}
+    struct {
+    {%- if allocation.offsets[pool[0]] %}
+      unsigned char offset[{{ allocation.offsets[pool[0]] }}];
+    {%- endif %}
+      union {
+      {%- for node in pool %}
+        {{ output(node) }}
+      {%- endfor %}
+      };
+    } activations{{ loop.index }};
+  {%- endfor %}
+  };
+{%- else %}
+{%- for pool in allocation.pools %}
+{%- if pool %}
+  union {
+  {%- for node in pool %}
+    {{ output(node) }}
+  {%- endfor %}
+  } activations{{ loop.index }};
+{%- endif %}
+{%- endfor %}
+{%- endif %}
+{%- for pool in allocation.scratch %}
+  // Scratch buffers are only used during a call of their layer, the layers of this union never run at the same time
+  union {
+  {%- for node in pool %}
+    {{ node.layer.name }}_scratch_type {{ node.layer.name }}_scratch;
+  {%- endfor %}
+  };
+{%- endfor %}
+  // Inference in progress with cnn_step_r()
+  const input_t *input;
+  output_t *output;
+  unsigned short layer;
+{% if schedule.stream %}
+  // Input window of cnn_push_r(), streamed layers keep their output of the previous window once primed
+  input_t stream_window;
+  unsigned char stream_primed;
+{% endif %}
+} cnn_ctx_t;
+
+size_t cnn_ctx_size(void);
+
+// Reentrant inference, all intermediate buffers are in ctx
+void cnn_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  output_t output);
+
+// Reentrant inference of n samples, processed in mini-batches of up to MODEL_MAX_BATCH samples
+void cnn_batch_r(
+  cnn_ctx_t *ctx,
+  const input_t *inputs,
+  output_t *outputs,
+  size_t n);
+
+/* Resumable inference of one sample, for example interleaved with I/O in the main loop of bare-metal firmware. cnn_step_r()
+ * runs at least one layer, then the next layers as long as their multiply-accumulate operations fit in macs (0 to run a single
+ * layer per call), and returns non-zero once the output is computed. input and output must stay valid until then. */
+void cnn_begin_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  output_t output);
 
+int cnn_step_r(
+  cnn_ctx_t *ctx,
+  unsigned long macs);
+
+int cnn_done_r(const cnn_ctx_t *ctx);
+{% if schedule.sequence is defined %}
+
+/* Inference of an input whose first samples rows only are valid, up to MODEL_INPUT_DIM_0: each layer only computes the output
+ * positions of the valid samples, as a model compiled for this length. Returns the number of valid output positions
+ * {{- ' summed by the last layer' if nodes[-1].layer.__class__.__name__ == 'TSumLayer' }}. */
+unsigned short cnn_sequence_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  unsigned short samples,
+  output_t output);
+{% endif %}
+{% if schedule.update_rows is defined %}
+
+/* Incremental inference of a frame differing from the previous frame of cnn_r() or cnn_update_r() on ctx only in input rows
+ * [start, end). The first layers ({{ schedule.update_rows | map(attribute='layer.name') | join(', ') or 'none' }}) only
+ * recompute the output rows whose receptive field overlaps these rows, the others are kept in ctx from the previous frame. */
+void cnn_update_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  unsigned short start,
+  unsigned short end,
+  output_t output);
+{% endif %}
+{% if schedule.stream %}
+
+/* Streaming inference over a sliding window of MODEL_INPUT_DIM_0 samples: cnn_push_r() appends MODEL_STREAM_HOP samples to the
+ * window, drops the oldest ones and computes the output of the model for the new window. The first layers
+ * ({{ schedule.stream.shifts | map(attribute='layer.name') | join(', ') or 'none' }}) only compute the output positions depending on
+ * the new samples. The window starts with zeros after cnn_stream_reset_r() (a zero-initialized context is also reset); cnn_r(),
+ * cnn_batch_r() and cnn_step_r() on the same context overwrite the stream state, reset it before pushing again. */
+void cnn_stream_reset_r(cnn_ctx_t *ctx);
+
+void cnn_push_r(
+  cnn_ctx_t *ctx,
+  const sample_t samples[MODEL_STREAM_HOP],
+  output_t output);
+{% endif %}
 
+// Same as cnn_r() and cnn_batch_r() with the context of the model, not reentrant
 void cnn(
   const input_t input,
   output_t output);
 
+{% if schedule.pipeline %}
+/* Built with WITH_THREADS, samples are streamed through a pipeline of {{ schedule.pipeline | length }} stages each running on its own
+ * thread. The first call starts the threads and allocates PIPELINE_CONTEXTS contexts of cnn_ctx_size() bytes
+ * ({{ schedule.pipeline | length + 1 }} by default) on the heap, kept for the following calls. */
+{% endif %}
+void cnn_batch(
+  const input_t *inputs,
+  output_t *outputs,
+  size_t n);
+
+void cnn_begin(
+  const input_t input,
+  output_t output);
+
+int cnn_step(unsigned long macs);
+
+int cnn_done(void);
+{% if schedule.sequence is defined %}
+
+unsigned short cnn_sequence(
+  const input_t input,
+  unsigned short samples,
+  output_t output);
+{% endif %}
+{% if schedule.update_rows is defined %}
+
+void cnn_update(
+  const input_t input,
+  unsigned short start,
+  unsigned short end,
+  output_t output);
+{% endif %}
+{% if schedule.stream %}
+
+void cnn_stream_reset(void);
+
+void cnn_push(
+  const sample_t samples[MODEL_STREAM_HOP],
+  output_t output);
+{% endif %}
+
 void reset(void);
 
 #endif//__MODEL_H__
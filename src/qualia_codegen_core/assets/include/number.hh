@@ -28,12 +28,40 @@ extern "C" {
 #include "arm_nnfunctions.h"
 #endif
 
+/* x86-64 SIMD backend for host builds: layer functions are compiled once per SIMD extension level (SSE4.2, AVX2, AVX-512)
+ * from the same portable loops and the best clone supported by the CPU is selected at load time, so a single binary runs on
+ * any x86-64 machine. Number helpers are inlined into each clone. Channel tiles of the kernels are sized for 256-bit vectors
+ * at most, build with -mprefer-vector-width=256 so that the AVX-512 clone does not use wider vectors.
+ * The epilogue of the tiles of convolutions and fully-connected layers scales and saturates a row of accumulators at once with
+ * the packing instructions of SSE2, part of the x86-64 baseline so that they are valid in every clone (VEX-encoded in the
+ * AVX2 and AVX-512 clones). */
+#ifdef WITH_X86_SIMD
+#if defined(WITH_CMSIS_NN) || defined(WITH_NMSIS_NN)
+#error "WITH_X86_SIMD cannot be combined with WITH_CMSIS_NN or WITH_NMSIS_NN"
+#endif
+#if !defined(__x86_64__) || !defined(__GNUC__)
+#error "WITH_X86_SIMD requires GCC or Clang targeting x86-64"
+#endif
+#include <emmintrin.h>
+#include <string.h>
+#if defined(__clang__) || __GNUC__ < 12
+#define X86_SIMD_DISPATCH __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+// Architecture levels also enable FMA with AVX2 and AVX-512BW/DQ/VL with AVX-512
+#define X86_SIMD_DISPATCH __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#endif
+#else
+#define X86_SIMD_DISPATCH
+#endif
+
 #define _clamp_to(type, number) clamp_to_number_t_ ## type (number)
 #define clamp_to(type, number) _clamp_to(type, number)
 #define _scale(type, number, scale_factor, round_mode) scale_number_t_ ## type (number, scale_factor, round_mode)
 #define scale(type, number, scale_factor, round_mode) _scale(type, number, scale_factor, round_mode)
 #define _scale_and_clamp_to(type, number, scale_factor, round_mode) scale_and_clamp_to_number_t_ ## type (number, scale_factor, round_mode)
 #define scale_and_clamp_to(type, number, scale_factor, round_mode) _scale_and_clamp_to(type, number, scale_factor, round_mode)
+#define _scale_and_clamp_to_n(type, number, output, n, n_max, scale_factor, round_mode) scale_and_clamp_to_n_number_t_ ## type (number, output, n, n_max, scale_factor, round_mode)
+#define scale_and_clamp_to_n(type, number, output, n, n_max, scale_factor, round_mode) _scale_and_clamp_to_n(type, number, output, n, n_max, scale_factor, round_mode)
 
 typedef enum {
   ROUND_MODE_NONE,
@@ -135,6 +163,71 @@ static inline {{ qtype2ctype(number_type.number_type, number_type.width) }} scal
 #endif
 }
 {%- endif %}
+{% set ctype = qtype2ctype(number_type.number_type, number_type.width) %}
+{% set long_ctype = qtype2ctype(number_type.number_type, number_type.long_width) %}
+#ifdef WITH_X86_SIMD
+{% if number_type.number_type.__name__ == 'int' and number_type.width in (8, 16) and number_type.long_width == 2 * number_type.width %}
+{% set lanes = 128 // number_type.long_width %}
+{% set bits = 'epi' ~ number_type.long_width %}
+static inline __m128i scale_vector_number_t_{{ ctype }}(__m128i number, __m128i half, __m128i shift, int scale_factor) {
+  if (scale_factor > 0) {
+    return _mm_sra_{{ bits }}(_mm_add_{{ bits }}(number, half), shift);
+  }
+  return _mm_sll_{{ bits }}(number, shift);
+}
+
+{% endif %}
+/* Scales and saturates n accumulators to output, same results as scale_and_clamp_to() on each of them. n_max is a bound of n
+ * known at compile time, vector stores wider than it are not generated. */
+static inline void scale_and_clamp_to_n_number_t_{{ ctype }}(
+  const {{ long_ctype }} *number, {{ ctype }} *output, size_t n, size_t n_max, int scale_factor, round_mode_t round_mode) {
+  size_t i = 0;
+{% if number_type.number_type.__name__ == 'int' and number_type.width in (8, 16) and number_type.long_width == 2 * number_type.width %}
+  size_t vector_n = n;
+  __m128i half = _mm_setzero_si128();
+  __m128i shift = _mm_cvtsi32_si128(scale_factor > 0 ? scale_factor : -scale_factor);
+  __m128i lo, hi;
+{% if number_type.width == 8 %}
+  int32_t packed;
+{% endif %}
+
+#ifdef TRAPV_SHIFT
+  // Overflow of left shifts is only checked by the scalar path
+  if (scale_factor <= 0) {
+    vector_n = 0;
+  }
+#endif
+  if (scale_factor > 0 && round_mode == ROUND_MODE_NEAREST) {
+    half = _mm_set1_{{ bits }}(({{ long_ctype }})(1 << (scale_factor - 1))); // +0.5 in fixed-point
+  }
+
+  // Two vectors of accumulators narrowed with signed saturation to a vector of outputs
+  for (; n_max >= {{ 2 * lanes }} && i + {{ 2 * lanes }} <= vector_n; i += {{ 2 * lanes }}) {
+    lo = scale_vector_number_t_{{ ctype }}(_mm_loadu_si128((const __m128i *)&number[i]), half, shift, scale_factor);
+    hi = scale_vector_number_t_{{ ctype }}(_mm_loadu_si128((const __m128i *)&number[i + {{ lanes }}]), half, shift, scale_factor);
+    _mm_storeu_si128((__m128i *)&output[i], _mm_packs_{{ bits }}(lo, hi));
+  }
+  // Single vector of accumulators to the low half of a vector of outputs
+  for (; n_max >= {{ lanes }} && i + {{ lanes }} <= vector_n; i += {{ lanes }}) {
+    lo = scale_vector_number_t_{{ ctype }}(_mm_loadu_si128((const __m128i *)&number[i]), half, shift, scale_factor);
+    _mm_storel_epi64((__m128i *)&output[i], _mm_packs_{{ bits }}(lo, lo));
+  }
+{% if number_type.width == 8 %}
+  // Half a vector of accumulators to 4 outputs
+  for (; n_max >= 4 && i + 4 <= vector_n; i += 4) {
+    lo = scale_vector_number_t_{{ ctype }}(_mm_loadl_epi64((const __m128i *)&number[i]), half, shift, scale_factor);
+    packed = _mm_cvtsi128_si32(_mm_packs_{{ bits }}(lo, lo));
+    memcpy(&output[i], &packed, sizeof(packed));
+  }
+{% endif %}
+{% else %}
+  (void)n_max;
+{% endif %}
+  for (; i < n; i++) {
+    output[i] = scale_and_clamp_to_number_t_{{ ctype }}(number[i], scale_factor, round_mode);
+  }
+}
+#endif
 
 {% endfor %}
 
@@ -0,0 +1,386 @@
+/**
+  ******************************************************************************
+  * @file    parallel.hh
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version 1.0.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+/* Multithreading for host builds: layers large enough are split in ranges of output rows, positions, units or channels
+ * computed by a persistent pool of POSIX threads, models with independent branches can run their layers as a task graph
+ * scheduled by work stealing and streams of samples can go through a pipeline of stages connected by queues. Workers
+ * poll for work for a short time after each range before going to sleep so that consecutive layers of an inference do
+ * not pay the wake-up latency. Calls from concurrent inferences (reentrant cnn_r()) or from a task of the graph while
+ * the pool is busy run on the calling thread.
+ *
+ * PARALLEL_THREADS sets the number of threads including the calling thread, all online processors by default. */
+#ifdef WITH_THREADS
+#if defined(WITH_CMSIS_NN) || defined(WITH_NMSIS_NN)
+#error "WITH_THREADS cannot be combined with WITH_CMSIS_NN or WITH_NMSIS_NN"
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifndef PARALLEL_MAX_THREADS
+#define PARALLEL_MAX_THREADS 64
+#endif
+#ifndef PARALLEL_SPIN
+#define PARALLEL_SPIN 200000 // Number of polls of a worker waiting for work before sleeping
+#endif
+#ifndef PARALLEL_QUEUE_SIZE
+#define PARALLEL_QUEUE_SIZE 16 // Capacity of the queues between pipeline stages
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define parallel_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define parallel_relax() __asm__ __volatile__("yield")
+#else
+#define parallel_relax()
+#endif
+
+// Computes output range [start, end) of a layer from its arguments
+typedef void (*parallel_task_t)(void * const args[], unsigned int start, unsigned int end);
+
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t busy;   // Held by the inference using the pool
+  pthread_mutex_t mutex;  // Protects sleeping workers
+  pthread_cond_t wake;
+  pthread_cond_t ready;   // Wakes workers sleeping in a task graph
+  unsigned int threads;
+  atomic_uint generation; // Incremented for each new task
+  atomic_uint pending;    // Workers that have not finished the current task
+  parallel_task_t task;
+  void * const *args;
+  unsigned int n;
+  unsigned int grain;
+  unsigned int chunks;
+} parallel_pool = { PTHREAD_ONCE_INIT, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+                    PTHREAD_COND_INITIALIZER, 0, 0, 0, NULL, NULL, 0, 0, 0 };
+
+// Range of chunk i: chunks are made of whole grains, only the last one may end with an incomplete grain
+static inline void parallel_chunk(unsigned int i, unsigned int *start, unsigned int *end) {
+  unsigned int grains = (parallel_pool.n + parallel_pool.grain - 1) / parallel_pool.grain;
+
+  *start = grains * i / parallel_pool.chunks * parallel_pool.grain;
+  *end = grains * (i + 1) / parallel_pool.chunks * parallel_pool.grain;
+  if (*end > parallel_pool.n)
+    *end = parallel_pool.n;
+}
+
+static void *parallel_worker(void *arg) {
+  unsigned int id = (unsigned int)(uintptr_t)arg;
+  unsigned int seen = 0, generation, spin, start, end;
+
+  for (;;) {
+    for (spin = 0; (generation = atomic_load_explicit(&parallel_pool.generation, memory_order_acquire)) == seen
+                   && spin < PARALLEL_SPIN; spin++) {
+      parallel_relax();
+    }
+    if (generation == seen) {
+      pthread_mutex_lock(&parallel_pool.mutex);
+      while ((generation = atomic_load_explicit(&parallel_pool.generation, memory_order_acquire)) == seen) {
+        pthread_cond_wait(&parallel_pool.wake, &parallel_pool.mutex);
+      }
+      pthread_mutex_unlock(&parallel_pool.mutex);
+    }
+    seen = generation;
+
+    // Every worker acknowledges each task so that the next one cannot start while a worker still reads this one
+    if (id < parallel_pool.chunks) {
+      parallel_chunk(id, &start, &end);
+      parallel_pool.task(parallel_pool.args, start, end);
+    }
+    atomic_fetch_sub_explicit(&parallel_pool.pending, 1, memory_order_release);
+  }
+  return NULL;
+}
+
+static void parallel_init(void) {
+  pthread_t thread;
+  unsigned int i;
+#ifdef PARALLEL_THREADS
+  long threads = PARALLEL_THREADS;
+#else
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  if (threads < 1)
+    threads = 1;
+  if (threads > PARALLEL_MAX_THREADS)
+    threads = PARALLEL_MAX_THREADS;
+
+  // Calling thread computes the first chunk, pool falls back to it for the remaining ones if a worker cannot be created
+  for (i = 1; i < threads; i++) {
+    if (pthread_create(&thread, NULL, parallel_worker, (void *)(uintptr_t)i) != 0)
+      break;
+    pthread_detach(thread);
+  }
+  parallel_pool.threads = i;
+}
+
+// Compute [0, n) in chunks of whole grains, one per thread, returns once all chunks are done
+static inline void parallel_for(parallel_task_t task, void * const args[], unsigned int n, unsigned int grain) {
+  unsigned int chunks, start, end;
+
+  pthread_once(&parallel_pool.once, parallel_init);
+
+  chunks = (n + grain - 1) / grain;
+  if (chunks > parallel_pool.threads)
+    chunks = parallel_pool.threads;
+
+  if (chunks <= 1 || pthread_mutex_trylock(&parallel_pool.busy) != 0) {
+    task(args, 0, n);
+    return;
+  }
+
+  parallel_pool.task = task;
+  parallel_pool.args = args;
+  parallel_pool.n = n;
+  parallel_pool.grain = grain;
+  parallel_pool.chunks = chunks;
+  atomic_store_explicit(&parallel_pool.pending, parallel_pool.threads - 1, memory_order_relaxed);
+
+  pthread_mutex_lock(&parallel_pool.mutex);
+  atomic_fetch_add_explicit(&parallel_pool.generation, 1, memory_order_release);
+  pthread_cond_broadcast(&parallel_pool.wake);
+  pthread_mutex_unlock(&parallel_pool.mutex);
+
+  parallel_chunk(0, &start, &end);
+  task(args, start, end);
+
+  while (atomic_load_explicit(&parallel_pool.pending, memory_order_acquire) > 0) {
+    parallel_relax();
+  }
+
+  pthread_mutex_unlock(&parallel_pool.busy);
+}
+
+// Number of threads of the pool including the calling thread
+static inline unsigned int parallel_threads(void) {
+  pthread_once(&parallel_pool.once, parallel_init);
+  return parallel_pool.threads;
+}
+
+/* Task graph executed by parallel_dag(): task i runs once its deps[i] predecessors are done, its successors are
+ * successors[first[i]] to successors[first[i + 1] - 1]. The storage of a run is sized by the caller from the number of
+ * tasks known at code generation time: remaining holds n counters and tasks PARALLEL_MAX_THREADS deques of n tasks. */
+typedef struct {
+  unsigned int n;
+  const unsigned short *deps;
+  const unsigned short *first;
+  const unsigned short *successors;
+  void (*run)(void *arg, unsigned int task);
+  void *arg;
+  atomic_uint *remaining;
+  unsigned short *tasks;
+} parallel_dag_t;
+
+// Tasks ready to run on a worker, the worker pops the last task pushed while other workers steal the first one
+typedef struct {
+  atomic_flag lock;
+  unsigned int top, bottom;
+  unsigned short *tasks;
+} parallel_deque_t;
+
+typedef struct {
+  const parallel_dag_t *dag;
+  unsigned int workers;
+  atomic_uint done;
+  atomic_uint queued;     // Tasks pushed to a deque and not taken yet
+  atomic_uint sleeping;   // Workers waiting on ready
+  parallel_deque_t *deques;
+} parallel_dag_state_t;
+
+static inline void parallel_deque_push(parallel_deque_t *deque, unsigned short task) {
+  while (atomic_flag_test_and_set_explicit(&deque->lock, memory_order_acquire)) {
+    parallel_relax();
+  }
+  deque->tasks[deque->bottom++] = task;
+  atomic_flag_clear_explicit(&deque->lock, memory_order_release);
+}
+
+static inline int parallel_deque_take(parallel_deque_t *deque, int steal, unsigned short *task) {
+  int found = 0;
+
+  while (atomic_flag_test_and_set_explicit(&deque->lock, memory_order_acquire)) {
+    parallel_relax();
+  }
+  if (deque->top < deque->bottom) {
+    *task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+    found = 1;
+  }
+  atomic_flag_clear_explicit(&deque->lock, memory_order_release);
+  return found;
+}
+
+// Make a task ready on a worker and wake up a sleeping worker to steal it
+static inline void parallel_dag_push(parallel_dag_state_t *state, unsigned int id, unsigned short task) {
+  // Sequentially consistent with a worker going to sleep: either it sees the new task or the pusher sees it sleeping
+  atomic_fetch_add(&state->queued, 1);
+  parallel_deque_push(&state->deques[id], task);
+  if (atomic_load(&state->sleeping) > 0) {
+    pthread_mutex_lock(&parallel_pool.mutex);
+    pthread_cond_signal(&parallel_pool.ready);
+    pthread_mutex_unlock(&parallel_pool.mutex);
+  }
+}
+
+// Sleep until a task is pushed or the whole graph is done
+static void parallel_dag_park(parallel_dag_state_t *state) {
+  pthread_mutex_lock(&parallel_pool.mutex);
+  atomic_fetch_add(&state->sleeping, 1);
+  while (atomic_load(&state->queued) == 0 && atomic_load(&state->done) < state->dag->n) {
+    pthread_cond_wait(&parallel_pool.ready, &parallel_pool.mutex);
+  }
+  atomic_fetch_sub(&state->sleeping, 1);
+  pthread_mutex_unlock(&parallel_pool.mutex);
+}
+
+/* Worker start of the pool, runs tasks until the whole graph is done. A worker without ready task polls the deques for a
+ * short time before sleeping. When the pool is busy the calling thread is the only worker and steals from the other
+ * deques once its own is empty. */
+static void parallel_dag_worker(void * const args[], unsigned int start, unsigned int end) {
+  parallel_dag_state_t *state = args[0];
+  const parallel_dag_t *dag = state->dag;
+  unsigned int id = start, victim, i, spin = 0;
+  unsigned short task;
+  int found;
+
+  (void)end;
+
+  while (atomic_load_explicit(&state->done, memory_order_acquire) < dag->n) {
+    found = parallel_deque_take(&state->deques[id], 0, &task);
+    for (i = 1; !found && i < state->workers; i++) {
+      victim = (id + i) % state->workers;
+      found = parallel_deque_take(&state->deques[victim], 1, &task);
+    }
+    if (!found) {
+      if (spin++ < PARALLEL_SPIN) {
+        parallel_relax();
+      } else {
+        parallel_dag_park(state);
+        spin = 0;
+      }
+      continue;
+    }
+    atomic_fetch_sub_explicit(&state->queued, 1, memory_order_relaxed);
+    spin = 0;
+
+    dag->run(dag->arg, task);
+
+    // Successors whose last predecessor is this task become ready on this worker
+    for (i = dag->first[task]; i < dag->first[task + 1]; i++) {
+      if (atomic_fetch_sub_explicit(&dag->remaining[dag->successors[i]], 1, memory_order_acq_rel) == 1)
+        parallel_dag_push(state, id, dag->successors[i]);
+    }
+
+    // Last task wakes up the sleeping workers so that they return to the pool
+    if (atomic_fetch_add_explicit(&state->done, 1, memory_order_acq_rel) + 1 == dag->n) {
+      pthread_mutex_lock(&parallel_pool.mutex);
+      pthread_cond_broadcast(&parallel_pool.ready);
+      pthread_mutex_unlock(&parallel_pool.mutex);
+    }
+  }
+}
+
+// Run all the tasks of the graph on the threads of the pool, returns once they are all done
+static inline void parallel_dag(const parallel_dag_t *dag) {
+  unsigned int workers = parallel_threads() < dag->n ? parallel_threads() : dag->n;
+  parallel_deque_t deques[PARALLEL_MAX_THREADS];
+  parallel_dag_state_t state = { dag, workers, 0, 0, 0, deques };
+  void * const args[] = { &state };
+  unsigned int i, ready = 0;
+
+  for (i = 0; i < workers; i++) {
+    atomic_flag_clear(&deques[i].lock);
+    deques[i].top = 0;
+    deques[i].bottom = 0;
+    deques[i].tasks = &dag->tasks[i * dag->n];
+  }
+
+  // Tasks without predecessors are spread across workers
+  for (i = 0; i < dag->n; i++) {
+    atomic_init(&dag->remaining[i], dag->deps[i]);
+    if (dag->deps[i] == 0)
+      parallel_deque_push(&deques[ready++ % workers], i);
+  }
+  atomic_init(&state.queued, ready);
+
+  parallel_for(parallel_dag_worker, args, workers, 1);
+}
+
+/* Lock-free single-producer single-consumer queue of pointers between pipeline stages. The consumer polls for a short time
+ * before sleeping, the producer only takes the mutex to wake it up. */
+typedef struct {
+  unsigned int head;      // Next item popped, only used by the consumer
+  atomic_uint tail;       // Next item pushed
+  atomic_int sleeping;    // Consumer waits on wake
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;
+  void *items[PARALLEL_QUEUE_SIZE];
+} parallel_queue_t;
+
+static inline void parallel_queue_init(parallel_queue_t *queue) {
+  queue->head = 0;
+  atomic_init(&queue->tail, 0);
+  atomic_init(&queue->sleeping, 0);
+  pthread_mutex_init(&queue->mutex, NULL);
+  pthread_cond_init(&queue->wake, NULL);
+}
+
+// Push an item, the caller ensures the queue is never full
+static inline void parallel_queue_push(parallel_queue_t *queue, void *item) {
+  unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  queue->items[tail % PARALLEL_QUEUE_SIZE] = item;
+  // Sequentially consistent with the consumer going to sleep: either it sees the new item or the producer sees it sleeping
+  atomic_store(&queue->tail, tail + 1);
+  if (atomic_load(&queue->sleeping)) {
+    pthread_mutex_lock(&queue->mutex);
+    pthread_cond_signal(&queue->wake);
+    pthread_mutex_unlock(&queue->mutex);
+  }
+}
+
+// Pop an item, waits until one is pushed
+static inline void *parallel_queue_pop(parallel_queue_t *queue) {
+  unsigned int spin;
+  void *item;
+
+  for (spin = 0; atomic_load_explicit(&queue->tail, memory_order_acquire) == queue->head && spin < PARALLEL_SPIN; spin++) {
+    parallel_relax();
+  }
+  if (atomic_load_explicit(&queue->tail, memory_order_acquire) == queue->head) {
+    pthread_mutex_lock(&queue->mutex);
+    atomic_store(&queue->sleeping, 1);
+    while (atomic_load(&queue->tail) == queue->head) {
+      pthread_cond_wait(&queue->wake, &queue->mutex);
+    }
+    atomic_store(&queue->sleeping, 0);
+    pthread_mutex_unlock(&queue->mutex);
+  }
+
+  item = queue->items[queue->head % PARALLEL_QUEUE_SIZE];
+  queue->head++;
+  return item;
+}
+#endif
+
+#endif //__PARALLEL_H__
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -23,6 +23,7 @@
 
 
 #ifdef ACTIVATION_SOFTMAX
+// vector_out may be the memory of vector_in when their elements have the same size, the sum is computed before any write
 static inline void {{ node.layer.name }}(
   const NUMBER_T vector_in[SAMPLES], // INT
   float vector_out[SAMPLES]) {    // OUT
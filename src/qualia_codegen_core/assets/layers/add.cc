@@ -25,6 +25,8 @@
 #define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
+// vector_out may be the memory of one of the inputs: each element is written after all the inputs at its position are read
+X86_SIMD_DISPATCH
 static inline void {{ node.layer.name }}(
 {% for innode in node.innodes %}
   const NUMBER_T vector_in_{{ loop.index }}{% for dim in node.input_shape[loop.index - 1][1:] %}[{{ dim }}]{% endfor %}, // doesn't work with inverted data_format
@@ -7,9 +7,46 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'parallel.cc' as parallel with context %}
+{#
+  Pooling of channels [channels.start, channels.end) in output rows [rows.start, rows.end).
+#}
+{% macro pool(channels, rows={'start': '0', 'end': 'POOL_HEIGHT'}) %}
+  unsigned short pos_x, pos_y, k; 	// loop indexes for output volume
+  unsigned int x, y;
+  LONG_NUMBER_T avg, tmp;
+
+  for (k = {{ channels.start }}; k < {{ channels.end }}; k++) 
+    for (pos_y = {{ rows.start }}; pos_y < {{ rows.end }}; pos_y++) {
+      for (pos_x = 0; pos_x < POOL_WIDTH; pos_x++) {
+        tmp = 0;
+
+        for (y = 0; y < POOL_SIZE_Y; y++) {
+          for (x = 0; x < POOL_SIZE_X; x++) {
+            tmp += input[(pos_y*POOL_STRIDE_Y)+y][(pos_x*POOL_STRIDE_X)+x][k];
+          }
+        }
+
+#ifdef ACTIVATION_RELU
+        if (tmp < 0) {
+          tmp = 0;
+        }
+#elif !defined(ACTIVATION_LINEAR)
+#error "Unsupported activation function"
+#endif
+
+        avg = tmp / (POOL_SIZE_X * POOL_SIZE_Y);
+
+        output[pos_y][pos_x][k] = scale_and_clamp_to(NUMBER_T, avg, INPUT_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+      }
+    }
+{%- endmacro %}
 #ifndef SINGLE_FILE
 #include "{{ node.layer.name }}.h"
 #include "number.h"
+{% if options.parallel %}
+#include "parallel.h"
+{% endif %}
 #endif
 
 #define INPUT_CHANNELS  {{ node.input_shape[0][-1] }}
@@ -34,39 +71,46 @@
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
 
-static inline void {{ node.layer.name }}(
+{% if options.parallel %}
+
+// Channels [start, end)
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_range(
   const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS], 	    // IN
-  NUMBER_T output[POOL_HEIGHT][POOL_WIDTH][INPUT_CHANNELS]) {	// OUT
+  NUMBER_T output[POOL_HEIGHT][POOL_WIDTH][INPUT_CHANNELS],	// OUT
+  unsigned short start,  // IN
+  unsigned short end) {  // IN
 
-  unsigned short pos_x, pos_y, k; 	// loop indexes for output volume
-  unsigned int x, y;
-  LONG_NUMBER_T avg, tmp;
+{{ pool({'start': 'start', 'end': 'end'}) }}
+}
 
-  for (k = 0; k < INPUT_CHANNELS; k++) 
-    for (pos_y = 0; pos_y < POOL_HEIGHT; pos_y++) {
-      for (pos_x = 0; pos_x < POOL_WIDTH; pos_x++) {
-        tmp = 0;
+{{ parallel.task(node, ['input', 'output']) }}
+{% endif %}
 
-        for (y = 0; y < POOL_SIZE_Y; y++) {
-          for (x = 0; x < POOL_SIZE_X; x++) {
-            tmp += input[(pos_y*POOL_STRIDE_Y)+y][(pos_x*POOL_STRIDE_X)+x][k];
-          }
-        }
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS], 	    // IN
+  NUMBER_T output[POOL_HEIGHT][POOL_WIDTH][INPUT_CHANNELS]) {	// OUT
 
-#ifdef ACTIVATION_RELU
-        if (tmp < 0) {
-          tmp = 0;
-        }
-#elif !defined(ACTIVATION_LINEAR)
-#error "Unsupported activation function"
-#endif
+{% if options.parallel %}
+{{ parallel.run(node, ['input', 'output']) }}
+{% else %}
+{{ pool({'start': '0', 'end': 'INPUT_CHANNELS'}) }}
+{% endif %}
+}
+{% if options['update'] %}
 
-        avg = tmp / (POOL_SIZE_X * POOL_SIZE_Y);
+// Updated layer: output rows outside of [start, end) are kept from the previous frame of cnn_update()
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_update(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS], 	    // IN
+  NUMBER_T output[POOL_HEIGHT][POOL_WIDTH][INPUT_CHANNELS],	// OUT
+  unsigned short start,  // IN
+  unsigned short end) {  // IN
 
-        output[pos_y][pos_x][k] = scale_and_clamp_to(NUMBER_T, avg, INPUT_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-      }
-    }
+{{ pool({'start': '0', 'end': 'INPUT_CHANNELS'}, {'start': 'start', 'end': 'end'}) }}
 }
+{% endif %}
 
 #undef INPUT_CHANNELS  
 #undef INPUT_WIDTH
@@ -28,6 +28,7 @@
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
 
+// output may be the memory of input, each element only depends on the input element at the same position
 static inline void {{ node.layer.name }}(
   const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],  // IN
   const NUMBER_T kernel[INPUT_CHANNELS],                // IN
@@ -7,9 +7,162 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'gemm.cc' as gemm %}
+{% import 'winograd.cc' as winograd %}
+{% import 'parallel.cc' as parallel with context %}
+{#
+  Tile of CONV_TILE_X output positions starting at pos_x x all filters, positions from limit are not computed.
+  Border tiles check each input row against input bounds [0, samples), interior tiles are known to be inside input.
+#}
+{% macro direct_tile(node, border, limit, samples='INPUT_SAMPLES') %}
+    for (g = 0; g < CONV_GROUPS; g++) {
+      for (r = 0; r < CONV_TILE_WINDOW; r++) {
+        input_x = pos_x * CONV_STRIDE - ZEROPADDING_LEFT + r;
+
+{% if border %}
+        if (input_x < 0 || input_x >= {{ samples }})
+          row[r] = zeros;
+        else
+          row[r] = &input[input_x][g * CHANNELS_PER_GROUP];
+{% else %}
+        row[r] = &input[input_x][g * CHANNELS_PER_GROUP];
+{% endif %}
+      }
+
+      for (k = g * FILTERS_PER_GROUP; k < (g + 1) * FILTERS_PER_GROUP; k += CONV_TILE_K) {
+        for (i = 0; i < CONV_TILE_X; i++) {
+          for (j = 0; j < CONV_TILE_K; j++) {
+            acc[i][j] = 0;
+          }
+        }
+
+{% if node.layer.kernel_size[0] in [3, 5, 7, 9] %}
+        // Kernel taps fully unrolled, channels innermost
+{% for x in range(node.layer.kernel_size[0]) %}
+        for (z = 0; z < CHANNELS_PER_GROUP; z++) {
+          for (i = 0; i < CONV_TILE_X; i++) {
+            for (j = 0; j < CONV_TILE_K; j++) {
+              acc[i][j] += (LONG_NUMBER_T)row[i * CONV_STRIDE + {{ x }}][z] * (LONG_NUMBER_T)kernel[k + j][{{ x }}][z];
+            }
+          }
+        }
+{% endfor %}
+{% else %}
+        for (x = 0; x < CONV_KERNEL_SIZE; x++) {
+          // Channels innermost, contiguous in both input and kernel
+          for (z = 0; z < CHANNELS_PER_GROUP; z++) {
+            for (i = 0; i < CONV_TILE_X; i++) {
+              for (j = 0; j < CONV_TILE_K; j++) {
+                acc[i][j] += (LONG_NUMBER_T)row[i * CONV_STRIDE + x][z] * (LONG_NUMBER_T)kernel[k + j][x][z];
+              }
+            }
+          }
+        }
+{% endif %}
+
+        for (i = 0; i < CONV_TILE_X{% if border %} && pos_x + i < {{ limit }}{% endif %}; i++) {
+{{ gemm.tile_epilogue(node, 'acc[i]', 'CONV_TILE_K', 'CONV_TILE_K', '&output[pos_x + i][k]', 'output[pos_x + i][k + j]') }}
+        }
+      }
+    }
+{%- endmacro %}
+{#
+  Depthwise tile of CONV_TILE_X output positions starting at pos_x x all channels, processed by tiles of DEPTHWISE_TILE_C
+  channels vectorized in channels_last order. Kernel is packed as [K][FILTERS].
+#}
+{% macro depthwise_tile(node, border, limit, samples='INPUT_SAMPLES') %}
+    for (k = 0; k < CONV_FILTERS; k += DEPTHWISE_TILE_C) {
+      for (i = 0; i < CONV_TILE_X; i++) {
+        for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+          acc[i][j] = 0;
+        }
+      }
+
+      for (x = 0; x < CONV_KERNEL_SIZE; x++) {
+        for (i = 0; i < CONV_TILE_X; i++) {
+          input_x = (pos_x + i) * CONV_STRIDE - ZEROPADDING_LEFT + x;
+{% if border %}
+
+          if (pos_x + i >= {{ limit }} || input_x < 0 || input_x >= {{ samples }})
+            in[i] = zeros;
+          else
+            in[i] = input[input_x];
+{% else %}
+          in[i] = input[input_x];
+{% endif %}
+        }
+
+        // Channels innermost, contiguous in input, packed kernel and output
+        for (i = 0; i < CONV_TILE_X; i++) {
+          for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+            acc[i][j] += (LONG_NUMBER_T)in[i][(k + j) / DEPTHWISE_MULTIPLIER] * (LONG_NUMBER_T)kernel[x][k + j];
+          }
+        }
+      }
+
+      for (i = 0; i < CONV_TILE_X{% if border %} && pos_x + i < {{ limit }}{% endif %}; i++) {
+{{ gemm.tile_epilogue(node, 'acc[i]', 'DEPTHWISE_TILE_C', 'DEPTHWISE_TILE_C', '&output[pos_x + i][k]', 'output[pos_x + i][k + j]') }}
+      }
+    }
+{%- endmacro %}
+{#
+  Direct or depthwise convolution of output positions [positions.start, positions.end), split in border positions on the left,
+  interior tiles and border positions on the right by the other bounds of positions. Input rows from positions.samples, if
+  given, are zeros.
+#}
+{% macro direct(positions) %}
+{% if options.conv_engine == 'depthwise' %}
+{% set tile = depthwise_tile %}
+  unsigned short pos_x, k; 	// loop indexes for output volume
+  unsigned short x, i, j;
+  int input_x;
+  LONG_NUMBER_T output_acc;
+  // Tile of CONV_TILE_X output positions x DEPTHWISE_TILE_C channels kept in registers
+  LONG_NUMBER_T acc[CONV_TILE_X][DEPTHWISE_TILE_C];
+  // Input rows of the tile, in border tiles rows outside of input (ZeroPadding1D) or output point to zeros
+  const NUMBER_T *in[CONV_TILE_X];
+  static const NUMBER_T zeros[INPUT_CHANNELS] = { 0 };
+{% else %}
+{% set tile = direct_tile %}
+  unsigned short pos_x, z, k, g; 	// loop indexes for output volume
+  unsigned short r, i, j;
+{% if node.layer.kernel_size[0] not in [3, 5, 7, 9] %}
+  unsigned short x;
+{% endif %}
+  int input_x;
+  LONG_NUMBER_T output_acc;
+  // Tile of CONV_TILE_X output positions x CONV_TILE_K filters kept in registers
+  LONG_NUMBER_T acc[CONV_TILE_X][CONV_TILE_K];
+  // Input rows covered by the windows of the tile, shared by overlapping windows so that each input value is loaded once
+  // for all positions and filters of the tile. In border tiles, rows outside of input (ZeroPadding1D) point to zeros
+  static const NUMBER_T zeros[CHANNELS_PER_GROUP] = { 0 };
+  const NUMBER_T *row[CONV_TILE_WINDOW];
+{% endif %}
+
+  pos_x = {{ positions.start }};
+{% if options.interior.start[0] > 0 %}
+  // Border positions on the left
+  for (; pos_x < {{ positions.left_end }}; pos_x += CONV_TILE_X) {
+{{ tile(node, True, positions.left_end, positions.get('samples', 'INPUT_SAMPLES')) }}
+  }
+
+{% endif %}
+  // Interior: every window of the tile is inside input, no padding check
+  for (pos_x = {{ positions.interior_start }}; pos_x + CONV_TILE_X <= {{ positions.interior_end }}; pos_x += CONV_TILE_X) {
+{{ tile(node, False, positions.interior_end) }}
+  }
+
+  // Border positions on the right and incomplete tile
+  for (; pos_x < {{ positions.end }}; pos_x += CONV_TILE_X) {
+{{ tile(node, True, positions.end, positions.get('samples', 'INPUT_SAMPLES')) }}
+  }
+{%- endmacro %}
 #ifndef SINGLE_FILE
 #include "{{ node.layer.name }}.h"
 #include "number.h"
+{% if options.parallel %}
+#include "parallel.h"
+{% endif %}
 #endif
 
 #ifdef WITH_CMSIS_NN
@@ -46,62 +199,198 @@
 #define OUTPUT_ROUND_MODE ROUND_MODE_{{ node.q.output_round_mode | upper }}
 #define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
+{% if options.conv_engine == 'im2col' %}
 
+// im2col + packed GEMM engine
+{{ gemm.defines(options.gemm) }}
+{%- elif options.conv_engine == 'winograd' %}
 
+// Winograd F({{ options.winograd.m }}, 3)
+{{ winograd.defines(options.winograd) }}
+{%- else %}
+
+#define CONV_TILE_X         {{ options.tile.x }}
+{% if options.conv_engine == 'depthwise' %}
+#define DEPTHWISE_MULTIPLIER {{ options.depthwise.multiplier }}
+#define DEPTHWISE_TILE_C    {{ options.depthwise.tile_c }}
+{% else %}
+#define CONV_TILE_K         {{ options.tile.k }}
+#define CONV_TILE_WINDOW    ( (CONV_TILE_X - 1) * CONV_STRIDE + CONV_KERNEL_SIZE )
+{% endif %}
+// Range of output positions whose window is entirely inside input, computed without padding checks
+#define CONV_INTERIOR_START {{ options.interior.start[0] }}
+#define CONV_INTERIOR_END   {{ options.interior.end[0] }}
+{% endif %}
+
+{% if options.parallel or options.stream %}
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+// Output positions [start, end)
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_range(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],                    // IN
+{% if options.conv_engine == 'depthwise' %}
+  const NUMBER_T kernel[CONV_KERNEL_SIZE][CONV_FILTERS],                  // IN
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+{% endif %}
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                      // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS],                         // OUT
+  unsigned short start,                                                   // IN
+  unsigned short end) {                                                   // IN
+
+  // Positions of the range in each of the border and interior loops
+{% if options.interior.start[0] > 0 %}
+  unsigned short left_end = end < CONV_INTERIOR_START ? end : CONV_INTERIOR_START;
+  unsigned short interior_start = start > CONV_INTERIOR_START ? start : CONV_INTERIOR_START;
+{% endif %}
+  unsigned short interior_end = end < CONV_INTERIOR_END ? end : CONV_INTERIOR_END;
+{{ direct({'start': 'start',
+           'left_end': 'left_end',
+           'interior_start': 'interior_start' if options.interior.start[0] > 0 else 'start',
+           'interior_end': 'interior_end',
+           'end': 'end'}) }}
+}
+{% if options.parallel %}
+
+{{ parallel.task(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output']) }}
+{% endif %}
+#endif
+{% endif %}
+
+X86_SIMD_DISPATCH
 static inline void {{ node.layer.name }}(
   const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],                    // IN
+{% if options.conv_engine == 'im2col' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[GEMM_PANELS][GEMM_K][GEMM_NR],                    // IN
+#else
   const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+#endif
+{% elif options.conv_engine == 'winograd' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const LONG_NUMBER_T kernel[CONV_FILTERS][WINOGRAD_POINTS][INPUT_CHANNELS],  // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+#endif
+{% elif options.conv_engine == 'depthwise' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[CONV_KERNEL_SIZE][CONV_FILTERS],                  // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+#endif
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+{% endif %}
 {% if node.layer.use_bias %}
   const NUMBER_T bias[CONV_FILTERS],						                          // IN
 {% endif %}
-  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS]) {                       // OUT
+  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS]{{ ',' if options.scratch else ') {' }}                       // OUT
+{% if options.scratch %}
+  {{ node.layer.name }}_scratch_type *scratch) {                                 // IN/OUT
+{% endif %}
 
 #if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
-  unsigned short pos_x, z, k; 	// loop indexes for output volume
-  unsigned short x;
+{% if options.conv_engine == 'im2col' %}
+{{ gemm.variables() }}
+{% if options.gemm.im2col %}
+  unsigned int m0, rows, lda;
+  unsigned short pos_x, x, z;
   int input_x;
-  LONG_NUMBER_T output_acc;
+  const NUMBER_T *a_rows;
+  NUMBER_T *col;
+  NUMBER_T (*im2col_buffer)[GEMM_K] = scratch->im2col_buffer;
 
-  for (pos_x = 0; pos_x < CONV_OUTSAMPLES; pos_x++) { 
-    for (k = 0; k < CONV_FILTERS; k++) { 
-      output_acc = 0;
+  for (m0 = 0; m0 < GEMM_M; m0 += IM2COL_ROWS) {
+    rows = GEMM_M - m0 < IM2COL_ROWS ? GEMM_M - m0 : IM2COL_ROWS;
 
-      for (x = 0; x < CONV_KERNEL_SIZE; x++) {
-        input_x = pos_x * CONV_STRIDE - ZEROPADDING_LEFT + x;
+    if ((int)(m0 * CONV_STRIDE) - ZEROPADDING_LEFT >= 0
+        && (int)((m0 + rows - 1) * CONV_STRIDE + CONV_KERNEL_SIZE) - ZEROPADDING_LEFT <= INPUT_SAMPLES) {
+      // Block does not overlap padding: overlapping windows are contiguous in input, no copy needed
+      a_rows = input[m0 * CONV_STRIDE - ZEROPADDING_LEFT];
+      lda = CONV_STRIDE * INPUT_CHANNELS;
+    } else {
+      // Copy window of each output position of the block to a row of im2col buffer, in kernel order [x][z]
+      for (m = 0; m < rows; m++) {
+        pos_x = m0 + m;
+        col = im2col_buffer[m];
 
-        if (input_x >= 0 && input_x < INPUT_SAMPLES) { // ZeroPadding1D
-          for (z = 0; z < INPUT_CHANNELS / CONV_GROUPS; z++) {
-            output_acc += (LONG_NUMBER_T)input[input_x][z + (k / FILTERS_PER_GROUP) * CHANNELS_PER_GROUP] * (LONG_NUMBER_T)kernel[k][x][z];
+        for (x = 0; x < CONV_KERNEL_SIZE; x++) {
+          input_x = pos_x * CONV_STRIDE - ZEROPADDING_LEFT + x;
+
+          if (input_x < 0 || input_x >= INPUT_SAMPLES) { // ZeroPadding1D
+            for (z = 0; z < INPUT_CHANNELS; z++) {
+              *col++ = 0;
+            }
+          } else {
+            for (z = 0; z < INPUT_CHANNELS; z++) {
+              *col++ = input[input_x][z];
+            }
           }
         }
       }
+      a_rows = im2col_buffer[0];
+      lda = GEMM_K;
+    }
 
-    // Scale for possible additional precision of bias
-    output_acc = scale(NUMBER_T, output_acc, WEIGHTS_SCALE_FACTOR - TMP_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-{% if node.layer.use_bias %}
-    // Scale bias to match accumulator
-    output_acc += scale(NUMBER_T, (LONG_NUMBER_T)bias[k], BIASES_SCALE_FACTOR - TMP_SCALE_FACTOR - INPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-{% endif %}
-      
-#ifdef ACTIVATION_LINEAR
-      output[pos_x][k] = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-#elif defined(ACTIVATION_RELU) || defined(ACTIVATION_RELU6)
-      // Activation function: ReLU
-      if (output_acc < 0) {
-        output[pos_x][k] = 0;
-      } else {
-#if defined(ACTIVATION_RELU6)
-        if (output_acc > scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE)) {
-          output_acc = scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE);
+{{ gemm.block(node, 'a_rows', 'lda', 'rows', 'm0', 'output') }}
+  }
+{% else %}
+  // Without padding, overlapping windows are contiguous in input: rows of the im2col matrix are read directly with a stride
+{{ gemm.block(node, 'input[0]', '(CONV_STRIDE * INPUT_CHANNELS)', 'GEMM_M', '0', 'output') }}
+{% endif %}
+{% elif options.conv_engine == 'winograd' %}
+{{ winograd.variables() }}
+  int input_x;
+  LONG_NUMBER_T y[WINOGRAD_M];
+
+  for (t0 = 0; t0 < WINOGRAD_TILES; t0 += WINOGRAD_BLOCK) {
+    tiles = WINOGRAD_TILES - t0 < WINOGRAD_BLOCK ? WINOGRAD_TILES - t0 : WINOGRAD_BLOCK;
+
+    // Input transform of each tile of the block
+    for (t = 0; t < tiles; t++) {
+      for (i = 0; i < WINOGRAD_ALPHA; i++) {
+        input_x = (t0 + t) * WINOGRAD_M - ZEROPADDING_LEFT + i;
+
+        if (input_x < 0 || input_x >= INPUT_SAMPLES) // ZeroPadding1D
+          in[i] = zeros;
+        else
+          in[i] = input[input_x];
+      }
+
+{{ winograd.input_transform(options.winograd, 1) }}
+    }
+
+    // Transformed kernel of a filter is reused for all tiles of the block
+    for (k = 0; k < CONV_FILTERS; k++) {
+      for (t = 0; t < tiles; t++) {
+{{ winograd.product() }}
+{{ winograd.output_transform(options.winograd, 1) }}
+        // Last tile may exceed output
+        for (i = 0; i < WINOGRAD_M && (t0 + t) * WINOGRAD_M + i < CONV_OUTSAMPLES; i++) {
+          output_acc = y[i];
+{{ gemm.epilogue(node, 'output[(t0 + t) * WINOGRAD_M + i][k]') }}
         }
-#endif
-        output[pos_x][k] = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
       }
-#else
-#error "Unsupported activation function"
-#endif
     }
   }
+{% else %}
+{% if options.parallel %}
+{{ parallel.run(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output']) }}
+{% else %}
+{{ direct({'start': '0',
+           'left_end': 'CONV_INTERIOR_START',
+           'interior_start': 'CONV_INTERIOR_START',
+           'interior_end': 'CONV_INTERIOR_END',
+           'end': 'CONV_OUTSAMPLES'}) }}
+{% endif %}
+{% endif %}
+{% if options.scratch %}
+
+  (void)scratch;
+{% endif %}
 
 #else
 {% if not node.layer.use_bias %}
@@ -112,7 +401,6 @@ static inline void {{ node.layer.name }}(
 #endif
 {% if qtype2ctype(node.q.number_type, node.q.width) == 'int8_t' %}
 
-  static q15_t bufferA[2*INPUT_CHANNELS*CONV_KERNEL_SIZE];
 #if INPUT_CHANNELS % 4 == 0 && CONV_FILTERS % 2 == 0
 #ifdef WITH_CMSIS_NN
   arm_convolve_HWC_q7_fast_nonsquare(
@@ -144,7 +432,7 @@ static inline void {{ node.layer.name }}(
                                       (q7_t*)output, //Im_out
                                       CONV_OUTSAMPLES, //dim_im_out_x
                                       1, //dim_im_out_y
-                                      bufferA, //bufferA
+                                      scratch->bufferA, //bufferA
                                       NULL //bufferB, unused
                                       );
 #ifdef ACTIVATION_RELU
@@ -158,7 +446,6 @@ static inline void {{ node.layer.name }}(
 #endif
 
 {% elif qtype2ctype(node.q.number_type, node.q.width) == 'int16_t' %}
-  static q15_t bufferA[2*INPUT_CHANNELS*CONV_KERNEL_SIZE];
 #if INPUT_CHANNELS % 2 == 0 && CONV_FILTERS % 2 == 0 && CONV_OUTSAMPLES % 2 == 0
 #ifdef WITH_CMSIS_NN
   arm_convolve_HWC_q15_fast_nonsquare(
@@ -190,7 +477,7 @@ static inline void {{ node.layer.name }}(
                                       (q15_t*)output, //Im_out
                                       CONV_OUTSAMPLES, //dim_im_out_x
                                       1, //dim_im_out_y
-                                      bufferA, //bufferA
+                                      scratch->bufferA, //bufferA
                                       NULL //bufferB, unused
                                       );
 #ifdef ACTIVATION_RELU
@@ -208,6 +495,92 @@ static inline void {{ node.layer.name }}(
 {% endif %}
 #endif
 }
+{% if options.sequence %}
+
+// Variable-length input: only the first samples rows of input are valid, windows reading past them see zeros as the padding of
+// a shorter input. Returns the number of valid output positions.
+X86_SIMD_DISPATCH
+static inline unsigned short {{ node.layer.name }}_length(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],                    // IN
+{% if options.conv_engine == 'depthwise' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[CONV_KERNEL_SIZE][CONV_FILTERS],                  // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+#endif
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+{% endif %}
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                      // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS],                         // OUT
+{% if options.scratch %}
+  {{ node.layer.name }}_scratch_type *scratch,                                   // IN/OUT
+{% endif %}
+  unsigned short samples) {                                               // IN
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  // Output positions of the valid rows, and of the windows entirely inside them
+  unsigned short end = samples + ZEROPADDING_LEFT + ZEROPADDING_RIGHT < CONV_KERNEL_SIZE ? 0
+                     : (samples + ZEROPADDING_LEFT + ZEROPADDING_RIGHT - CONV_KERNEL_SIZE) / CONV_STRIDE + 1;
+  unsigned short interior_end = samples + ZEROPADDING_LEFT < CONV_KERNEL_SIZE ? 0
+                              : (samples + ZEROPADDING_LEFT - CONV_KERNEL_SIZE) / CONV_STRIDE + 1;
+{% if options.interior.start[0] > 0 %}
+  unsigned short left_end = end < CONV_INTERIOR_START ? end : CONV_INTERIOR_START;
+{% endif %}
+{{ direct({'start': '0',
+           'left_end': 'left_end',
+           'interior_start': 'CONV_INTERIOR_START',
+           'interior_end': 'interior_end',
+           'end': 'end',
+           'samples': 'samples'}) }}
+{% if options.scratch %}
+
+  (void)scratch;
+{% endif %}
+
+  return end;
+#else
+#error "Variable-length inference is not supported with CMSIS-NN/NMSIS-NN"
+#endif
+}
+{% endif %}
+{% if options.stream %}
+
+// Streamed layer: output positions before start are already computed from the previous input window, shifted by cnn_push()
+static inline void {{ node.layer.name }}_stream(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],                    // IN
+{% if options.conv_engine == 'depthwise' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[CONV_KERNEL_SIZE][CONV_FILTERS],                  // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+#endif
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS],  // IN
+{% endif %}
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                      // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS],                         // OUT
+{% if options.scratch %}
+  {{ node.layer.name }}_scratch_type *scratch,                                   // IN/OUT
+{% endif %}
+  unsigned short start) {                                                 // IN
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+{% if options.scratch %}
+  (void)scratch;
+{% endif %}
+  {{ node.layer.name }}_range(input, kernel, {{ 'bias, ' if node.layer.use_bias }}output, start, CONV_OUTSAMPLES);
+#else
+  // Library kernels always compute the whole output
+  (void)start;
+  {{ node.layer.name }}(input, kernel, {{ 'bias, ' if node.layer.use_bias }}output{{ ', scratch' if options.scratch }});
+#endif
+}
+{% endif %}
 
 #undef INPUT_CHANNELS
 #undef INPUT_SAMPLES
@@ -228,3 +601,19 @@ static inline void {{ node.layer.name }}(
 #undef OUTPUT_SCALE_FACTOR
 #undef NUMBER_T
 #undef LONG_NUMBER_T
+{% if options.conv_engine == 'im2col' %}
+{{ gemm.undefs() }}
+{%- elif options.conv_engine == 'winograd' %}
+{{ winograd.undefs() }}
+{%- else %}
+#undef CONV_TILE_X
+{% if options.conv_engine == 'depthwise' %}
+#undef DEPTHWISE_MULTIPLIER
+#undef DEPTHWISE_TILE_C
+{% else %}
+#undef CONV_TILE_K
+#undef CONV_TILE_WINDOW
+{% endif %}
+#undef CONV_INTERIOR_START
+#undef CONV_INTERIOR_END
+{% endif %}
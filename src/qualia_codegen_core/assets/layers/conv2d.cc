@@ -7,9 +7,178 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'gemm.cc' as gemm %}
+{% import 'winograd.cc' as winograd %}
+{% import 'parallel.cc' as parallel with context %}
+{#
+  Tile of CONV_TILE_X output positions starting at pos_x x all filters of the row pos_y, positions from limit are not computed.
+  Border tiles check each tap against input bounds, interior tiles are known at code generation time to be inside input.
+#}
+{% macro direct_tile(node, border, limit) %}
+        for (g = 0; g < CONV_GROUPS; g++) {
+          for (k = g * FILTERS_PER_GROUP; k < (g + 1) * FILTERS_PER_GROUP; k += CONV_TILE_K) {
+            for (i = 0; i < CONV_TILE_X; i++) {
+              for (j = 0; j < CONV_TILE_K; j++) {
+                acc[i][j] = 0;
+              }
+            }
+
+            for (y = 0; y < CONV_KERNEL_SIZE_Y; y++) {
+{% if border %}
+              input_y = pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y;
+
+{% endif %}
+              for (x = 0; x < CONV_KERNEL_SIZE_X; x++) {
+                for (i = 0; i < CONV_TILE_X; i++) {
+{% if border %}
+                  input_x = (pos_x + i) * CONV_STRIDE_X - ZEROPADDING_LEFT + x;
+
+                  if (pos_x + i >= {{ limit }} || input_x < 0 || input_x >= INPUT_WIDTH || input_y < 0 || input_y >= INPUT_HEIGHT)
+                    in[i] = zeros;
+                  else
+                    in[i] = &input[input_y][input_x][g * CHANNELS_PER_GROUP];
+{% else %}
+                  in[i] = &input[pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y][(pos_x + i) * CONV_STRIDE_X - ZEROPADDING_LEFT + x][g * CHANNELS_PER_GROUP];
+{% endif %}
+                }
+
+                // Channels innermost, contiguous in both input and kernel
+                for (z = 0; z < CHANNELS_PER_GROUP; z++) {
+                  for (i = 0; i < CONV_TILE_X; i++) {
+                    for (j = 0; j < CONV_TILE_K; j++) {
+                      acc[i][j] += (LONG_NUMBER_T)in[i][z] * (LONG_NUMBER_T)kernel[k + j][y][x][z];
+                    }
+                  }
+                }
+              }
+            }
+
+            for (i = 0; i < CONV_TILE_X{% if border %} && pos_x + i < {{ limit }}{% endif %}; i++) {
+{{ gemm.tile_epilogue(node, 'acc[i]', 'CONV_TILE_K', 'CONV_TILE_K', '&output[pos_y][pos_x + i][k]', 'output[pos_y][pos_x + i][k + j]') | indent(2, true) }}
+            }
+          }
+        }
+{%- endmacro %}
+{#
+  Depthwise tile of CONV_TILE_X output positions starting at pos_x x all channels of the row pos_y, processed by tiles of
+  DEPTHWISE_TILE_C channels vectorized in channels_last order. Kernel is packed as [KY][KX][FILTERS].
+#}
+{% macro depthwise_tile(node, border, limit) %}
+        for (k = 0; k < CONV_FILTERS; k += DEPTHWISE_TILE_C) {
+          for (i = 0; i < CONV_TILE_X; i++) {
+            for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+              acc[i][j] = 0;
+            }
+          }
+
+          for (y = 0; y < CONV_KERNEL_SIZE_Y; y++) {
+{% if border %}
+            input_y = pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y;
+
+{% endif %}
+            for (x = 0; x < CONV_KERNEL_SIZE_X; x++) {
+              for (i = 0; i < CONV_TILE_X; i++) {
+{% if border %}
+                input_x = (pos_x + i) * CONV_STRIDE_X - ZEROPADDING_LEFT + x;
+
+                if (pos_x + i >= {{ limit }} || input_x < 0 || input_x >= INPUT_WIDTH || input_y < 0 || input_y >= INPUT_HEIGHT)
+                  in[i] = zeros;
+                else
+                  in[i] = input[input_y][input_x];
+{% else %}
+                in[i] = input[pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y][(pos_x + i) * CONV_STRIDE_X - ZEROPADDING_LEFT + x];
+{% endif %}
+              }
+
+              // Channels innermost, contiguous in input, packed kernel and output
+              for (i = 0; i < CONV_TILE_X; i++) {
+                for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+                  acc[i][j] += (LONG_NUMBER_T)in[i][(k + j) / DEPTHWISE_MULTIPLIER] * (LONG_NUMBER_T)kernel[y][x][k + j];
+                }
+              }
+            }
+          }
+
+          for (i = 0; i < CONV_TILE_X{% if border %} && pos_x + i < {{ limit }}{% endif %}; i++) {
+{{ gemm.tile_epilogue(node, 'acc[i]', 'DEPTHWISE_TILE_C', 'DEPTHWISE_TILE_C', '&output[pos_y][pos_x + i][k]', 'output[pos_y][pos_x + i][k + j]') }}
+          }
+        }
+{%- endmacro %}
+{#
+  Direct or depthwise convolution of output rows [rows.start, rows.end), split in border rows on the top, interior rows and
+  border rows on the bottom by the other bounds of rows.
+#}
+{% macro direct(rows) %}
+{% if options.conv_engine == 'depthwise' %}
+{% set tile = depthwise_tile %}
+  unsigned short pos_x, pos_y, k; 	// loop indexes for output volume
+  unsigned short x, y, i, j;
+  int input_x, input_y;
+  LONG_NUMBER_T output_acc;
+  // Output-stationary tile of CONV_TILE_X output positions x DEPTHWISE_TILE_C channels kept in registers
+  LONG_NUMBER_T acc[CONV_TILE_X][DEPTHWISE_TILE_C];
+  const NUMBER_T *in[CONV_TILE_X];
+  // Pixels of border tiles outside of input (ZeroPadding2D) or output point to zeros
+  static const NUMBER_T zeros[INPUT_CHANNELS] = { 0 };
+{% else %}
+{% set tile = direct_tile %}
+  unsigned short pos_x, pos_y, z, k, g; 	// loop indexes for output volume
+  unsigned short x, y, i, j;
+  int input_x, input_y;
+  LONG_NUMBER_T output_acc;
+  // Output-stationary tile of CONV_TILE_X output positions x CONV_TILE_K filters kept in registers
+  LONG_NUMBER_T acc[CONV_TILE_X][CONV_TILE_K];
+  const NUMBER_T *in[CONV_TILE_X];
+  // Rows of border tiles outside of input (ZeroPadding2D) or output point to zeros
+  static const NUMBER_T zeros[CHANNELS_PER_GROUP] = { 0 };
+{% endif %}
+
+  // Rows are split in separate loops rather than tested in the loop: compilers may predict such a test on the induction
+  // variable as never taken and optimize the interior for size
+{% if options.interior.start[0] > 0 %}
+  // Border rows on the top
+  for (pos_y = {{ rows.start }}; pos_y < {{ rows.top_end }}; pos_y++) {
+    for (pos_x = 0; pos_x < CONV_OUTWIDTH; pos_x += CONV_TILE_X) {
+{{ tile(node, True, 'CONV_OUTWIDTH') }}
+    }
+  }
+
+{% endif %}
+  for (pos_y = {{ rows.interior_start }}; pos_y < {{ rows.interior_end }}; pos_y++) {
+    pos_x = 0;
+{% if options.interior.start[1] > 0 %}
+    // Border columns on the left
+    for (; pos_x < CONV_INTERIOR_START_X; pos_x += CONV_TILE_X) {
+{{ tile(node, True, 'CONV_INTERIOR_START_X') }}
+    }
+
+{% endif %}
+    // Interior: every tap of the tile is inside input, no padding check
+    for (pos_x = CONV_INTERIOR_START_X; pos_x + CONV_TILE_X <= CONV_INTERIOR_END_X; pos_x += CONV_TILE_X) {
+{{ tile(node, False, 'CONV_INTERIOR_END_X') }}
+    }
+
+    // Border columns on the right and incomplete tile
+    for (; pos_x < CONV_OUTWIDTH; pos_x += CONV_TILE_X) {
+{{ tile(node, True, 'CONV_OUTWIDTH') }}
+    }
+  }
+{% if options.interior.end[0] < node.output_shape[0][-3] %}
+
+  // Border rows on the bottom
+  for (pos_y = {{ rows.bottom_start }}; pos_y < {{ rows.end }}; pos_y++) {
+    for (pos_x = 0; pos_x < CONV_OUTWIDTH; pos_x += CONV_TILE_X) {
+{{ tile(node, True, 'CONV_OUTWIDTH') }}
+    }
+  }
+{% endif %}
+{%- endmacro %}
 #ifndef SINGLE_FILE
 #include "{{ node.layer.name }}.h"
 #include "number.h"
+{% if options.parallel %}
+#include "parallel.h"
+{% endif %}
 #endif
 
 #ifdef WITH_CMSIS_NN
@@ -54,81 +223,214 @@
 #define OUTPUT_ROUND_MODE ROUND_MODE_{{ node.q.output_round_mode | upper }}
 #define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
+{% if options.conv_engine == 'im2col' %}
+
+// im2col + packed GEMM engine
+{{ gemm.defines(options.gemm) }}
+{%- elif options.conv_engine == 'winograd' %}
+
+// Winograd F({{ options.winograd.m }}x{{ options.winograd.m }}, 3x3)
+{{ winograd.defines(options.winograd) }}
+{%- else %}
+
+#define CONV_TILE_X        {{ options.tile.x }}
+{% if options.conv_engine == 'depthwise' %}
+#define DEPTHWISE_MULTIPLIER {{ options.depthwise.multiplier }}
+#define DEPTHWISE_TILE_C   {{ options.depthwise.tile_c }}
+{% else %}
+#define CONV_TILE_K        {{ options.tile.k }}
+{% endif %}
+// Range of output positions whose receptive field is entirely inside input, computed without padding checks
+#define CONV_INTERIOR_START_Y {{ options.interior.start[0] }}
+#define CONV_INTERIOR_END_Y   {{ options.interior.end[0] }}
+#define CONV_INTERIOR_START_X {{ options.interior.start[1] }}
+#define CONV_INTERIOR_END_X   {{ options.interior.end[1] }}
+{% endif %}
+
+{% if options.parallel or options['update'] %}
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+// Output rows [start, end)
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_range(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],               // IN
+{% if options.conv_engine == 'depthwise' %}
+  const NUMBER_T kernel[CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][CONV_FILTERS],   // IN
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+{% endif %}
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                             // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS],                  // OUT
+  unsigned short start,                                                          // IN
+  unsigned short end) {                                                          // IN
+
+  // Rows of the range in each of the border and interior loops
+{% if options.interior.start[0] > 0 %}
+  unsigned short top_end = end < CONV_INTERIOR_START_Y ? end : CONV_INTERIOR_START_Y;
+  unsigned short interior_start = start > CONV_INTERIOR_START_Y ? start : CONV_INTERIOR_START_Y;
+{% endif %}
+  unsigned short interior_end = end < CONV_INTERIOR_END_Y ? end : CONV_INTERIOR_END_Y;
+{% if options.interior.end[0] < node.output_shape[0][-3] %}
+  unsigned short bottom_start = start > CONV_INTERIOR_END_Y ? start : CONV_INTERIOR_END_Y;
+{% endif %}
+{{ direct({'start': 'start',
+           'top_end': 'top_end',
+           'interior_start': 'interior_start' if options.interior.start[0] > 0 else 'start',
+           'interior_end': 'interior_end',
+           'bottom_start': 'bottom_start',
+           'end': 'end'}) }}
+}
+{% if options.parallel %}
 
+{{ parallel.task(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output']) }}
+{% endif %}
+#endif
+{% endif %}
 
+X86_SIMD_DISPATCH
 static inline void {{ node.layer.name }}(
   const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],               // IN
-  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_X][CONV_KERNEL_SIZE_Y][INPUT_CHANNELS / CONV_GROUPS], // IN
+{% if options.conv_engine == 'im2col' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[GEMM_PANELS][GEMM_K][GEMM_NR],                          // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+#endif
+{% elif options.conv_engine == 'winograd' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const LONG_NUMBER_T kernel[CONV_FILTERS][WINOGRAD_POINTS][INPUT_CHANNELS],     // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+#endif
+{% elif options.conv_engine == 'depthwise' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][CONV_FILTERS],   // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+#endif
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+{% endif %}
 {% if node.layer.use_bias %}
   const NUMBER_T bias[CONV_FILTERS],						                // IN
 {% endif %}
-  NUMBER_T output[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS]) {               // OUT
+  NUMBER_T output[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS]{{ ',' if options.scratch else ') {' }}               // OUT
+{% if options.scratch %}
+  {{ node.layer.name }}_scratch_type *scratch) {                                 // IN/OUT
+{% endif %}
 
 #if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
-  unsigned short pos_x, pos_y, z, k; 	// loop indexes for output volume
-  unsigned short x, y;
+{% if options.conv_engine == 'im2col' %}
+{{ gemm.variables() }}
+  NUMBER_T (*output_rows)[CONV_FILTERS] = (NUMBER_T (*)[CONV_FILTERS])output;
+{% if options.gemm.im2col %}
+  unsigned int m0, rows;
+  unsigned short pos_x, pos_y, x, y, z;
   int input_x, input_y;
-  LONG_NUMBER_T	kernel_mac;
-  LONG_NUMBER_T tmp;
-  static LONG_NUMBER_T	output_acc[CONV_OUTHEIGHT][CONV_OUTWIDTH];
-
-  for (k = 0; k < CONV_FILTERS; k++) { 
-    for (pos_y = 0; pos_y < CONV_OUTHEIGHT; pos_y++) { 
-      for (pos_x = 0; pos_x < CONV_OUTWIDTH; pos_x++) { 
-        output_acc[pos_y][pos_x] = 0;
-
-        for (z = 0; z < INPUT_CHANNELS / CONV_GROUPS; z++) {
-          kernel_mac = 0; 
-            
-          for (y = 0; y < CONV_KERNEL_SIZE_Y; y++) {
-            input_y = pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y;
+  NUMBER_T *col;
+  NUMBER_T (*im2col_buffer)[GEMM_K] = scratch->im2col_buffer;
 
-            for (x = 0; x < CONV_KERNEL_SIZE_X; x++) {
-              input_x = pos_x * CONV_STRIDE_X - ZEROPADDING_LEFT + x;
+  for (m0 = 0; m0 < GEMM_M; m0 += IM2COL_ROWS) {
+    rows = GEMM_M - m0 < IM2COL_ROWS ? GEMM_M - m0 : IM2COL_ROWS;
+
+    // Copy receptive field of each output position of the block to a row of im2col buffer, in kernel order [y][x][z]
+    for (m = 0; m < rows; m++) {
+      pos_y = (m0 + m) / CONV_OUTWIDTH;
+      pos_x = (m0 + m) % CONV_OUTWIDTH;
+      col = im2col_buffer[m];
+
+      for (y = 0; y < CONV_KERNEL_SIZE_Y; y++) {
+        input_y = pos_y * CONV_STRIDE_Y - ZEROPADDING_TOP + y;
+
+        for (x = 0; x < CONV_KERNEL_SIZE_X; x++) {
+          input_x = pos_x * CONV_STRIDE_X - ZEROPADDING_LEFT + x;
 
-              if (input_x < 0 || input_x >= INPUT_WIDTH || input_y < 0 || input_y >= INPUT_HEIGHT) // ZeroPadding2D
-                tmp = 0;
-              else
-                tmp = (LONG_NUMBER_T)input[input_y][input_x][z + (k / FILTERS_PER_GROUP) * CHANNELS_PER_GROUP] * (LONG_NUMBER_T)kernel[k][y][x][z];
-              kernel_mac = kernel_mac + tmp;
+          if (input_x < 0 || input_x >= INPUT_WIDTH || input_y < 0 || input_y >= INPUT_HEIGHT) { // ZeroPadding2D
+            for (z = 0; z < INPUT_CHANNELS; z++) {
+              *col++ = 0;
+            }
+          } else {
+            for (z = 0; z < INPUT_CHANNELS; z++) {
+              *col++ = input[input_y][input_x][z];
             }
           }
+        }
+      }
+    }
+
+{{ gemm.block(node, 'im2col_buffer[0]', 'GEMM_K', 'rows', 'm0', 'output_rows') }}
+  }
+{% else %}
+  // 1x1 convolution: each input pixel is a row of the im2col matrix
+{{ gemm.block(node, '(const NUMBER_T *)input', 'INPUT_CHANNELS', 'GEMM_M', '0', 'output_rows') }}
+{% endif %}
+{% elif options.conv_engine == 'winograd' %}
+{{ winograd.variables() }}
+  unsigned short tile_y, tile_x, j;
+  int input_x, input_y;
+  LONG_NUMBER_T tmp[WINOGRAD_ALPHA][WINOGRAD_ALPHA];
+  LONG_NUMBER_T y[WINOGRAD_M][WINOGRAD_M];
+
+  for (t0 = 0; t0 < WINOGRAD_TILES; t0 += WINOGRAD_BLOCK) {
+    tiles = WINOGRAD_TILES - t0 < WINOGRAD_BLOCK ? WINOGRAD_TILES - t0 : WINOGRAD_BLOCK;
+
+    // Input transform of each tile of the block
+    for (t = 0; t < tiles; t++) {
+      tile_y = (t0 + t) / WINOGRAD_TILES_X;
+      tile_x = (t0 + t) % WINOGRAD_TILES_X;
+
+      for (i = 0; i < WINOGRAD_ALPHA; i++) {
+        input_y = tile_y * WINOGRAD_M - ZEROPADDING_TOP + i;
 
-          output_acc[pos_y][pos_x] = output_acc[pos_y][pos_x] + kernel_mac;
+        for (j = 0; j < WINOGRAD_ALPHA; j++) {
+          input_x = tile_x * WINOGRAD_M - ZEROPADDING_LEFT + j;
 
+          if (input_x < 0 || input_x >= INPUT_WIDTH || input_y < 0 || input_y >= INPUT_HEIGHT) // ZeroPadding2D
+            in[i * WINOGRAD_ALPHA + j] = zeros;
+          else
+            in[i * WINOGRAD_ALPHA + j] = input[input_y][input_x];
         }
       }
+
+{{ winograd.input_transform(options.winograd, 2) }}
     }
 
-    for (pos_y = 0; pos_y < CONV_OUTHEIGHT; pos_y++) { 
-      for (pos_x = 0; pos_x < CONV_OUTWIDTH; pos_x++) { 
-        // Scale for possible additional precision of bias
-        output_acc[pos_y][pos_x] = scale(NUMBER_T, output_acc[pos_y][pos_x],  WEIGHTS_SCALE_FACTOR - TMP_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-{% if node.layer.use_bias %}
-        // Scale bias to match accumulator
-        output_acc[pos_y][pos_x] += scale(NUMBER_T, (LONG_NUMBER_T)bias[k], BIASES_SCALE_FACTOR - TMP_SCALE_FACTOR - INPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-{% endif %}
-
-#ifdef ACTIVATION_LINEAR
-        output[pos_y][pos_x][k] = scale_and_clamp_to(NUMBER_T, output_acc[pos_y][pos_x], INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-#elif defined(ACTIVATION_RELU) || defined(ACTIVATION_RELU6)
-        // Activation function: ReLU
-        if (output_acc[pos_y][pos_x] < 0) {
-          output[pos_y][pos_x][k] = 0;
-        } else {
-#if defined(ACTIVATION_RELU6)
-        if (output_acc[pos_y][pos_x] > scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE)) {
-          output_acc[pos_y][pos_x] = scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE);
-        }
-#endif
-          output[pos_y][pos_x][k] = scale_and_clamp_to(NUMBER_T, output_acc[pos_y][pos_x], INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+    // Transformed kernel of a filter is reused for all tiles of the block
+    for (k = 0; k < CONV_FILTERS; k++) {
+      for (t = 0; t < tiles; t++) {
+        tile_y = (t0 + t) / WINOGRAD_TILES_X;
+        tile_x = (t0 + t) % WINOGRAD_TILES_X;
+
+{{ winograd.product() }}
+{{ winograd.output_transform(options.winograd, 2) }}
+        // Last row and column of tiles may exceed output
+        for (i = 0; i < WINOGRAD_M && tile_y * WINOGRAD_M + i < CONV_OUTHEIGHT; i++) {
+          for (j = 0; j < WINOGRAD_M && tile_x * WINOGRAD_M + j < CONV_OUTWIDTH; j++) {
+            output_acc = y[i][j];
+{{ gemm.epilogue(node, 'output[tile_y * WINOGRAD_M + i][tile_x * WINOGRAD_M + j][k]') }}
+          }
         }
-#else
-#error "Unsupported activation function"
-#endif
       }
     }
   }
+{% else %}
+{% if options.parallel %}
+{{ parallel.run(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output']) }}
+{% else %}
+{{ direct({'start': '0',
+           'top_end': 'CONV_INTERIOR_START_Y',
+           'interior_start': 'CONV_INTERIOR_START_Y',
+           'interior_end': 'CONV_INTERIOR_END_Y',
+           'bottom_start': 'CONV_INTERIOR_END_Y',
+           'end': 'CONV_OUTHEIGHT'}) }}
+{% endif %}
+{% endif %}
+{% if options.scratch %}
+
+  (void)scratch;
+{% endif %}
 #else
 {% if not node.layer.use_bias %}
 #error "CMSIS-NN requires the use of bias"
@@ -138,7 +440,6 @@ static inline void {{ node.layer.name }}(
 #endif
 {% if qtype2ctype(node.q.number_type, node.q.width) == 'int8_t' %}
 
-  static q15_t bufferA[INPUT_HEIGHT*INPUT_WIDTH*INPUT_CHANNELS];
 #ifdef WITH_CMSIS_NN
   arm_convolve_HWC_q7_basic_nonsquare(
 #elif defined(WITH_NMSIS_NN)
@@ -162,7 +463,7 @@ static inline void {{ node.layer.name }}(
                                       (q7_t*)output, //Im_out
                                       CONV_OUTWIDTH, //dim_im_out_x
                                       CONV_OUTHEIGHT, //dim_im_out_y
-                                      bufferA, //bufferA
+                                      scratch->bufferA, //bufferA
                                       NULL //bufferB, unused
                                       );
 #ifdef ACTIVATION_RELU
@@ -176,7 +477,6 @@ static inline void {{ node.layer.name }}(
 #endif
 
 {% elif qtype2ctype(node.q.number_type, node.q.width) == 'int16_t' %}
-  static q15_t bufferA[INPUT_HEIGHT*INPUT_WIDTH*INPUT_CHANNELS];
 #ifdef WITH_CMSIS_NN
   arm_convolve_HWC_q15_basic_nonsquare(
 #elif defined(WITH_NMSIS_NN)
@@ -200,7 +500,7 @@ static inline void {{ node.layer.name }}(
                                       (q15_t*)output, //Im_out
                                       CONV_OUTWIDTH, //dim_im_out_x
                                       CONV_OUTHEIGHT, //dim_im_out_y
-                                      bufferA, //bufferA
+                                      scratch->bufferA, //bufferA
                                       NULL //bufferB, unused
                                       );
 #ifdef ACTIVATION_RELU
@@ -218,6 +518,43 @@ static inline void {{ node.layer.name }}(
 {% endif %}
 #endif
 }
+{% if options['update'] %}
+
+// Updated layer: output rows outside of [start, end) are kept from the previous frame of cnn_update()
+static inline void {{ node.layer.name }}_update(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],               // IN
+{% if options.conv_engine == 'depthwise' %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  const NUMBER_T kernel[CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][CONV_FILTERS],   // IN
+#else
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+#endif
+{% else %}
+  const NUMBER_T kernel[CONV_FILTERS][CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][INPUT_CHANNELS / CONV_GROUPS], // IN
+{% endif %}
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                             // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS],                  // OUT
+{% if options.scratch %}
+  {{ node.layer.name }}_scratch_type *scratch,                                   // IN/OUT
+{% endif %}
+  unsigned short start,                                                          // IN
+  unsigned short end) {                                                          // IN
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+{% if options.scratch %}
+  (void)scratch;
+{% endif %}
+  {{ node.layer.name }}_range(input, kernel, {{ 'bias, ' if node.layer.use_bias }}output, start, end);
+#else
+  // Library kernels always compute the whole output
+  (void)start;
+  (void)end;
+  {{ node.layer.name }}(input, kernel, {{ 'bias, ' if node.layer.use_bias }}output{{ ', scratch' if options.scratch }});
+#endif
+}
+{% endif %}
 
 #undef INPUT_CHANNELS
 #undef INPUT_WIDTH
@@ -244,3 +581,20 @@ static inline void {{ node.layer.name }}(
 #undef OUTPUT_SCALE_FACTOR
 #undef NUMBER_T
 #undef LONG_NUMBER_T
+{% if options.conv_engine == 'im2col' %}
+{{ gemm.undefs() }}
+{%- elif options.conv_engine == 'winograd' %}
+{{ winograd.undefs() }}
+{%- else %}
+#undef CONV_TILE_X
+{% if options.conv_engine == 'depthwise' %}
+#undef DEPTHWISE_MULTIPLIER
+#undef DEPTHWISE_TILE_C
+{% else %}
+#undef CONV_TILE_K
+{% endif %}
+#undef CONV_INTERIOR_START_Y
+#undef CONV_INTERIOR_END_Y
+#undef CONV_INTERIOR_START_X
+#undef CONV_INTERIOR_END_X
+{% endif %}
@@ -7,9 +7,87 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'gemm.cc' as gemm %}
+{% import 'parallel.cc' as parallel with context %}
+{% set blocked = options.fc.input_block < node.input_shape[0][-1] %}
+{#
+  Multiply-accumulate of input samples [start, end) with the panel p of FC_TILE units, each input sample is loaded once for all
+  the units of the panel. Samples are innermost in the kernel so that each unit is a contiguous dot product.
+#}
+{% macro panel(acc, start, end) %}
+      for (z = {{ start }}; z < {{ end }}; z++) {
+        for (j = 0; j < FC_TILE; j++) {
+          {{ acc }}[j] += (LONG_NUMBER_T)input[z] * (LONG_NUMBER_T)kernel[p][j][z];
+        }
+      }
+{%- endmacro %}
+{#
+  Multiply-accumulate of input samples [start, end) of the FC_BATCH_TILE samples of the mini-batch starting at b with the panel p,
+  each weight loaded is used for all the samples of the tile.
+#}
+{% macro batch_panel(acc, start, end) %}
+      for (z = {{ start }}; z < {{ end }}; z++) {
+        for (s = 0; s < FC_BATCH_TILE; s++) {
+          for (j = 0; j < FC_TILE; j++) {
+            {{ acc }}[s][j] += (LONG_NUMBER_T)input[b + s][z] * (LONG_NUMBER_T)kernel[p][j][z];
+          }
+        }
+      }
+{%- endmacro %}
+{#
+  Epilogue of the panel starting at unit k to the output vector out, zero-padded units of the last panel are not written.
+#}
+{% macro panel_epilogue(acc, out) %}
+    units = FC_UNITS - k < FC_TILE ? FC_UNITS - k : FC_TILE;
+{{ gemm.tile_epilogue(node, acc, 'units', '(FC_UNITS < FC_TILE ? FC_UNITS : FC_TILE)', '&' ~ out ~ '[k]', out ~ '[k + j]') }}
+{%- endmacro %}
+{#
+  Fully-connected units of panels [panels.start, panels.end), first unit is panels.k.
+#}
+{% macro dense(panels) %}
+  unsigned short p, k, z, j, units;
+  LONG_NUMBER_T output_acc;
+{% if blocked %}
+  unsigned short block, block_end;
+  // Accumulators of all units, kept across blocks of input
+  LONG_NUMBER_T (*acc)[FC_TILE] = scratch->acc;
+
+  for (p = {{ panels.start }}; p < {{ panels.end }}; p++) {
+    for (j = 0; j < FC_TILE; j++) {
+      acc[p][j] = 0;
+    }
+  }
+
+  for (block = 0; block < INPUT_SAMPLES; block += FC_INPUT_BLOCK) {
+    block_end = INPUT_SAMPLES - block < FC_INPUT_BLOCK ? INPUT_SAMPLES : block + FC_INPUT_BLOCK;
+    for (p = {{ panels.start }}; p < {{ panels.end }}; p++) {
+{{ panel('acc[p]', 'block', 'block_end') }}
+    }
+  }
+
+  for (p = {{ panels.start }}, k = {{ panels.k }}; p < {{ panels.end }}; p++, k += FC_TILE) {
+{{ panel_epilogue('acc[p]', 'output') }}
+  }
+{% else %}
+  LONG_NUMBER_T acc[FC_TILE];
+
+  for (p = {{ panels.start }}, k = {{ panels.k }}; p < {{ panels.end }}; p++, k += FC_TILE) {
+    for (j = 0; j < FC_TILE; j++) {
+      acc[j] = 0;
+    }
+
+{{ panel('acc', 0, 'INPUT_SAMPLES') }}
+
+{{ panel_epilogue('acc', 'output') }}
+  }
+{% endif %}
+{%- endmacro %}
 #ifndef SINGLE_FILE
 #include "{{ node.layer.name }}.h"
 #include "number.h"
+{% if options.parallel %}
+#include "parallel.h"
+{% endif %}
 #endif
 
 #ifdef WITH_CMSIS_NN
@@ -32,49 +110,65 @@
 #define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
+// Units computed in one pass over input, kernel is packed as [FC_PANELS][FC_TILE][INPUT_SAMPLES]
+#define FC_TILE {{ options.fc.tile }}
+#define FC_PANELS {{ options.fc.panels }}
+// Samples of input read by all panels before moving to the next block
+#define FC_INPUT_BLOCK {{ options.fc.input_block }}
+// Samples of a mini-batch sharing each panel in cnn_batch()
+#define FC_BATCH_TILE {{ options.fc.batch_tile }}
 
+{% if options.parallel %}
+
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+// Units of panels [start, end)
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_range(
+  const NUMBER_T input[INPUT_SAMPLES],                        // IN
+  const NUMBER_T kernel[FC_PANELS][FC_TILE][INPUT_SAMPLES],   // IN
+{% if node.layer.use_bias %}
+  const NUMBER_T bias[FC_UNITS],                              // IN
+{% endif %}
+  NUMBER_T output[FC_UNITS],                                  // OUT
+{% if blocked %}
+  {{ node.layer.name }}_scratch_type *scratch,                // IN/OUT
+{% endif %}
+  unsigned short start,                                       // IN
+  unsigned short end) {                                       // IN
+
+{{ dense({'start': 'start', 'end': 'end', 'k': 'start * FC_TILE'}) }}
+}
+
+{{ parallel.task(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output'] + (['scratch'] if blocked else [])) }}
+#endif
+{% endif %}
+
+X86_SIMD_DISPATCH
 static inline void {{ node.layer.name }}(
   const NUMBER_T input[INPUT_SAMPLES], 			      // IN
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+	const NUMBER_T kernel[FC_PANELS][FC_TILE][INPUT_SAMPLES],  // IN
+#else
 	const NUMBER_T kernel[FC_UNITS][INPUT_SAMPLES],  // IN
+#endif
 {% if node.layer.use_bias %}
 	const NUMBER_T bias[FC_UNITS],			              // IN
 {% endif %}
-	NUMBER_T output[FC_UNITS]) {			                // OUT
+	NUMBER_T output[FC_UNITS]{{ ',' if options.scratch else ') {' }}			                // OUT
+{% if options.scratch %}
+	{{ node.layer.name }}_scratch_type *scratch) {    // IN/OUT
+{% endif %}
 
 #if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
-  unsigned short k, z; 
-  LONG_NUMBER_T output_acc;
-
-  for (k = 0; k < FC_UNITS; k++) { 
-    output_acc = 0;
-    for (z = 0; z < INPUT_SAMPLES; z++) 
-      output_acc = output_acc + ((LONG_NUMBER_T)kernel[k][z] * (LONG_NUMBER_T)input[z]);
-
-    output_acc = scale(NUMBER_T, output_acc, WEIGHTS_SCALE_FACTOR - TMP_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-{% if node.layer.use_bias %}
-    output_acc += scale(NUMBER_T, (LONG_NUMBER_T)bias[k], BIASES_SCALE_FACTOR - TMP_SCALE_FACTOR - INPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+{% if options.parallel %}
+{{ parallel.run(node, ['input', 'kernel'] + (['bias'] if node.layer.use_bias else []) + ['output'] + (['scratch'] if blocked else [])) }}
+{% else %}
+{{ dense({'start': '0', 'end': 'FC_PANELS', 'k': '0'}) }}
 {% endif %}
+{% if options.scratch %}
 
-    // Activation function
-#ifdef ACTIVATION_LINEAR
-    // Linear (MEANS NONE)
-    output[k] = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-#elif defined(ACTIVATION_RELU) || defined(ACTIVATION_RELU6)
-    // ReLU
-    if (output_acc < 0) {
-      output[k] = 0;
-    } else {
-#if defined(ACTIVATION_RELU6)
-      if (output_acc > scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE)) {
-        output_acc = scale(NUMBER_T, 6, -(INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR), OUTPUT_ROUND_MODE);
-      }
-#endif
-      output[k] = scale_and_clamp_to(NUMBER_T, output_acc, INPUT_SCALE_FACTOR + TMP_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-    }
-#else
-#error "Unsupported activation function"
-#endif
-  }
+  (void)scratch;
+{% endif %}
 #else
 {% if not node.layer.use_bias %}
 #error "CMSIS-NN requires the use of bias"
@@ -83,7 +177,6 @@ static inline void {{ node.layer.name }}(
 #error "CMSIS-NN does not support BIASES_SCALE_FACTOR larger than WEIGHTS_SCALE_FACTOR"
 #endif
 {% if qtype2ctype(node.q.number_type, node.q.width) == 'int8_t' %}
-  static q15_t bufferA[INPUT_SAMPLES];
 #ifdef WITH_CMSIS_NN
   arm_fully_connected_q7(
 #elif defined(WITH_NMSIS_NN)
@@ -97,7 +190,7 @@ static inline void {{ node.layer.name }}(
                              INPUT_SCALE_FACTOR + WEIGHTS_SCALE_FACTOR - OUTPUT_SCALE_FACTOR,
                              (q7_t*)bias,
                              (q7_t*)output,
-                             (q15_t*)bufferA);
+                             (q15_t*)scratch->bufferA);
 #ifdef ACTIVATION_RELU
 #ifdef WITH_CMSIS_NN
   arm_relu_q7((q7_t*)output, FC_UNITS);
@@ -109,7 +202,6 @@ static inline void {{ node.layer.name }}(
 #endif
 
 {% elif qtype2ctype(node.q.number_type, node.q.width) == 'int16_t' %}
-  static q15_t bufferA[INPUT_SAMPLES];
 #ifdef WITH_CMSIS_NN
   arm_fully_connected_q15(
 #elif defined(WITH_NMSIS_NN)
@@ -123,7 +215,7 @@ static inline void {{ node.layer.name }}(
                              INPUT_SCALE_FACTOR + WEIGHTS_SCALE_FACTOR - OUTPUT_SCALE_FACTOR,
                              (q15_t*)bias,
                              (q15_t*)output,
-                             (q15_t*)bufferA);
+                             (q15_t*)scratch->bufferA);
 #ifdef ACTIVATION_RELU
 #ifdef WITH_CMSIS_NN
   arm_relu_q15((q15_t*)output, FC_UNITS);
@@ -140,8 +232,88 @@ static inline void {{ node.layer.name }}(
 #endif
 }
 
+// Mini-batch of samples: tiles of FC_BATCH_TILE samples are multiplied with the kernel as a matrix, remaining samples one by one
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_batch(
+  const NUMBER_T input[][INPUT_SAMPLES],              // IN
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+	const NUMBER_T kernel[FC_PANELS][FC_TILE][INPUT_SAMPLES],  // IN
+#else
+	const NUMBER_T kernel[FC_UNITS][INPUT_SAMPLES],  // IN
+#endif
+{% if node.layer.use_bias %}
+	const NUMBER_T bias[FC_UNITS],			              // IN
+{% endif %}
+	NUMBER_T output[][FC_UNITS],                      // OUT
+{% if options.scratch %}
+	{{ node.layer.name }}_scratch_type *scratch,      // IN/OUT
+{% endif %}
+	unsigned short batch) {                           // IN
+
+  unsigned short b = 0;
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+  unsigned short s, p, k, z, j, units;
+  LONG_NUMBER_T output_acc;
+{% if blocked %}
+  unsigned short block, end;
+  // Accumulators of all units for the samples of the tile, kept across blocks of input
+  LONG_NUMBER_T (*acc)[FC_BATCH_TILE][FC_TILE] = scratch->batch_acc;
+
+  for (; b + FC_BATCH_TILE <= batch; b += FC_BATCH_TILE) {
+    for (p = 0; p < FC_PANELS; p++) {
+      for (s = 0; s < FC_BATCH_TILE; s++) {
+        for (j = 0; j < FC_TILE; j++) {
+          acc[p][s][j] = 0;
+        }
+      }
+    }
+
+    for (block = 0; block < INPUT_SAMPLES; block += FC_INPUT_BLOCK) {
+      end = INPUT_SAMPLES - block < FC_INPUT_BLOCK ? INPUT_SAMPLES : block + FC_INPUT_BLOCK;
+      for (p = 0; p < FC_PANELS; p++) {
+{{ batch_panel('acc[p]', 'block', 'end') }}
+      }
+    }
+
+    for (p = 0, k = 0; p < FC_PANELS; p++, k += FC_TILE) {
+      for (s = 0; s < FC_BATCH_TILE; s++) {
+{{ panel_epilogue('acc[p][s]', 'output[b + s]') }}
+      }
+    }
+  }
+{% else %}
+  LONG_NUMBER_T acc[FC_BATCH_TILE][FC_TILE];
+
+  for (; b + FC_BATCH_TILE <= batch; b += FC_BATCH_TILE) {
+    for (p = 0, k = 0; p < FC_PANELS; p++, k += FC_TILE) {
+      for (s = 0; s < FC_BATCH_TILE; s++) {
+        for (j = 0; j < FC_TILE; j++) {
+          acc[s][j] = 0;
+        }
+      }
+
+{{ batch_panel('acc', 0, 'INPUT_SAMPLES') }}
+
+      for (s = 0; s < FC_BATCH_TILE; s++) {
+{{ panel_epilogue('acc[s]', 'output[b + s]') }}
+      }
+    }
+  }
+{% endif %}
+#endif
+
+  // Remaining samples
+  for (; b < batch; b++) {
+    {{ node.layer.name }}(input[b], kernel, {% if node.layer.use_bias %}bias, {% endif %}output[b]{% if options.scratch %}, scratch{% endif %});
+  }
+}
+
 #undef INPUT_SAMPLES
 #undef FC_UNITS
+#undef FC_TILE
+#undef FC_PANELS
+#undef FC_INPUT_BLOCK
+#undef FC_BATCH_TILE
 #undef ACTIVATION_{{ node.layer.activation.name | upper }}
 #undef WEIGHTS_SCALE_FACTOR
 #undef BIASES_SCALE_FACTOR
@@ -7,9 +7,46 @@
   * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
   */
 
+{% import 'parallel.cc' as parallel with context %}
+{#
+  Pooling of channels [channels.start, channels.end) at output positions [start, end).
+#}
+{% macro pool(channels, start='0', end='POOL_LENGTH') %}
+  unsigned short pos_x, k; 	// loop indexes for output volume
+  unsigned int x;
+  LONG_NUMBER_T *max = scratch->max;
+
+  for (pos_x = {{ start }}; pos_x < {{ end }}; pos_x++) {
+    for (k = {{ channels.start }}; k < {{ channels.end }}; k++) {
+#ifdef ACTIVATION_LINEAR
+      max[k] = input[pos_x*POOL_STRIDE][k];
+      x = 1;
+#elif defined(ACTIVATION_RELU)
+      max[k] = 0;
+      x = 0;
+#else
+#error "Unsupported activation function"
+#endif
+    }
+
+    for (; x < POOL_SIZE; x++) {
+      for (k = {{ channels.start }}; k < {{ channels.end }}; k++) {
+        if (max[k] < input[(pos_x * POOL_STRIDE) + x][k])
+          max[k] = input[(pos_x * POOL_STRIDE) + x][k];
+      }
+    }
+
+    for (k = {{ channels.start }}; k < {{ channels.end }}; k++) {
+      output[pos_x][k] = scale_and_clamp_to(NUMBER_T, max[k], INPUT_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+    }
+  }
+{%- endmacro %}
 #ifndef SINGLE_FILE
 #include "{{ node.layer.name }}.h"
 #include "number.h"
+{% if options.parallel %}
+#include "parallel.h"
+{% endif %}
 #endif
 
 #ifdef WITH_CMSIS_NN
@@ -33,39 +70,63 @@
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
 
+{% if options.parallel %}
+
+// Channels [start, end)
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_range(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS], 	    // IN
+  NUMBER_T output[POOL_LENGTH][INPUT_CHANNELS],	// OUT
+  {{ node.layer.name }}_scratch_type *scratch,	// IN/OUT
+  unsigned short start,  // IN
+  unsigned short end) {  // IN
+
+{{ pool({'start': 'start', 'end': 'end'}) }}
+}
+
+{{ parallel.task(node, ['input', 'output', 'scratch']) }}
+{% endif %}
+
+X86_SIMD_DISPATCH
 static inline void {{ node.layer.name }}(
   const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS], 	    // IN
-  NUMBER_T output[POOL_LENGTH][INPUT_CHANNELS]) {	// OUT
+  NUMBER_T output[POOL_LENGTH][INPUT_CHANNELS],	// OUT
+  {{ node.layer.name }}_scratch_type *scratch) {	// IN/OUT
 
-  unsigned short pos_x, k; 	// loop indexes for output volume
-  unsigned int x;
-  static LONG_NUMBER_T max[INPUT_CHANNELS];
+{% if options.parallel %}
+{{ parallel.run(node, ['input', 'output', 'scratch']) }}
+{% else %}
+{{ pool({'start': '0', 'end': 'INPUT_CHANNELS'}) }}
+{% endif %}
+}
+{% if options.sequence %}
 
-  for (pos_x = 0; pos_x < POOL_LENGTH; pos_x++) {
-    for (k = 0; k < INPUT_CHANNELS; k++) {
-#ifdef ACTIVATION_LINEAR
-      max[k] = input[pos_x*POOL_STRIDE][k];
-      x = 1;
-#elif defined(ACTIVATION_RELU)
-      max[k] = 0;
-      x = 0;
-#else
-#error "Unsupported activation function"
-#endif
-    }
+// Variable-length input: only the first samples rows of input are valid. Returns the number of valid output positions.
+X86_SIMD_DISPATCH
+static inline unsigned short {{ node.layer.name }}_length(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS], 	    // IN
+  NUMBER_T output[POOL_LENGTH][INPUT_CHANNELS],	// OUT
+  {{ node.layer.name }}_scratch_type *scratch,	// IN/OUT
+  unsigned short samples) {	// IN
+  unsigned short end = samples < POOL_SIZE ? 0 : (samples - POOL_SIZE) / POOL_STRIDE + 1;
+{{ pool({'start': '0', 'end': 'INPUT_CHANNELS'}, '0', 'end') }}
 
-    for (; x < POOL_SIZE; x++) {
-      for (k = 0; k < INPUT_CHANNELS; k++) {
-        if (max[k] < input[(pos_x * POOL_STRIDE) + x][k])
-          max[k] = input[(pos_x * POOL_STRIDE) + x][k];
-      }
-    }
+  return end;
+}
+{% endif %}
+{% if options.stream %}
 
-    for (k = 0; k < INPUT_CHANNELS; k++) {
-      output[pos_x][k] = scale_and_clamp_to(NUMBER_T, max[k], INPUT_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
-    }
-  }
+// Streamed layer: output positions before start are already computed from the previous input window, shifted by cnn_push()
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_stream(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS], 	    // IN
+  NUMBER_T output[POOL_LENGTH][INPUT_CHANNELS],	// OUT
+  {{ node.layer.name }}_scratch_type *scratch,	// IN/OUT
+  unsigned short start) {	// IN
+
+{{ pool({'start': '0', 'end': 'INPUT_CHANNELS'}, 'start') }}
 }
+{% endif %}
 
 #undef INPUT_CHANNELS  
 #undef INPUT_SAMPLES
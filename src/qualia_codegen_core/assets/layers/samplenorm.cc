@@ -20,6 +20,7 @@
 #define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
 #define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
 
+// output may be the memory of input, each channel is only written after its minimum and maximum are found
 static inline void {{ node.layer.name }}(
   const NUMBER_T input{% for dim in node.input_shape[0][1:] %}[{{ dim }}]{% endfor %}, // IN
   {{ node.layer.name }}_output_type output) {    // OUT
@@ -0,0 +1,166 @@
+/**
+  ******************************************************************************
+  * @file    separableconv1d.cc
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version V2.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+{% import 'separableconv.cc' as separableconv %}
+{% set depthwise = node.layer.depthwise %}
+{% set batchnorm = node.layer.batchnorm %}
+{% set pointwise = node.layer.pointwise %}
+#ifndef SINGLE_FILE
+#include "{{ node.layer.name }}.h"
+#include "number.h"
+#endif
+
+#define INPUT_CHANNELS      {{ node.input_shape[0][-1] }}
+#define INPUT_SAMPLES       {{ node.input_shape[0][-2] }}
+#define DEPTHWISE_FILTERS   {{ depthwise.layer.filters }}
+#define DEPTHWISE_MULTIPLIER {{ options.depthwise.multiplier }}
+#define DEPTHWISE_TILE_C    {{ options.depthwise.tile_c }}
+#define CONV_KERNEL_SIZE    {{ depthwise.layer.kernel_size[0] }}
+{% if depthwise.layer.padding == 'valid' %}
+#define ZEROPADDING_LEFT    0
+{% else %}
+#define ZEROPADDING_LEFT    {{ depthwise.layer.padding[0] }}
+{% endif %}
+// Stride between the input windows of two output positions, depthwise stride x pointwise stride
+#define SEPARABLE_STRIDE    {{ options.strides[0] }}
+#define CONV_FILTERS        {{ pointwise.layer.filters }}
+#define CONV_OUTSAMPLES     {{ node.output_shape[0][-2] }}
+#define CONV_TILE_X         {{ options.tile.x }}
+#define CONV_TILE_K         {{ options.tile.k }}
+// Range of output positions whose depthwise window is entirely inside input, computed without padding checks
+#define SEPARABLE_INTERIOR_START {{ options.interior.start[0] }}
+#define SEPARABLE_INTERIOR_END   {{ options.interior.end[0] }}
+// Number of output positions computed from the line buffer at once
+#define LINE_SAMPLES        {{ options.line }}
+
+#define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
+#define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
+
+// Depthwise convolution of output positions [pos_x, pos_x + samples) to the line buffer
+{{ separableconv.stage_defines(depthwise, node.innodes[0]) }}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_depthwise(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],          // IN
+  const NUMBER_T kernel[CONV_KERNEL_SIZE][DEPTHWISE_FILTERS],   // IN
+{% if depthwise.layer.use_bias %}
+  const NUMBER_T bias[DEPTHWISE_FILTERS],                       // IN
+{% endif %}
+  unsigned short pos_x,                                         // IN
+  unsigned short samples,                                       // IN
+  NUMBER_T line[LINE_SAMPLES][DEPTHWISE_FILTERS]) {             // OUT
+
+  unsigned short i, k, j, t, start, end;
+  int input_x, x;
+{{ separableconv.depthwise_variables() }}
+  // Interior positions of the block, bounds are computed before the loops rather than tested in the loop
+{% if options.interior.start[0] > 0 %}
+  start = pos_x < SEPARABLE_INTERIOR_START ? SEPARABLE_INTERIOR_START - pos_x : 0;
+{% else %}
+  start = 0;
+{% endif %}
+  end = pos_x < SEPARABLE_INTERIOR_END ? SEPARABLE_INTERIOR_END - pos_x : 0;
+  start = start < samples ? start : samples;
+  end = end < samples ? end : samples;
+
+  // Border positions on the left
+  for (i = 0; i < start; i += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, True, 1, 'i', 'pos_x + i', 'start') }}
+  }
+
+  // Interior: every tap is inside input, no padding check
+  for (i = start; i + CONV_TILE_X <= end; i += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, False, 1, 'i', 'pos_x + i', None) }}
+  }
+
+  // Border positions on the right and remaining interior positions
+  for (; i < samples; i += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, True, 1, 'i', 'pos_x + i', 'samples') }}
+  }
+}
+{{ separableconv.stage_undefs(depthwise) }}
+{% if batchnorm %}
+
+// BatchNorm of the line buffer, in place
+{{ separableconv.stage_defines(batchnorm, depthwise) }}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_batchnorm(
+  const NUMBER_T kernel[DEPTHWISE_FILTERS],           // IN
+  const NUMBER_T bias[DEPTHWISE_FILTERS],             // IN
+  unsigned short samples,                             // IN
+  NUMBER_T line[LINE_SAMPLES][DEPTHWISE_FILTERS]) {   // IN/OUT
+
+{{ separableconv.batchnorm(batchnorm, 'samples') }}
+}
+{{ separableconv.stage_undefs(batchnorm) }}
+{% endif %}
+
+// Pointwise convolution of the line buffer to output positions
+{{ separableconv.stage_defines(pointwise, batchnorm if batchnorm else depthwise) }}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_pointwise(
+  const NUMBER_T line[LINE_SAMPLES][DEPTHWISE_FILTERS],     // IN
+  const NUMBER_T kernel[CONV_FILTERS][DEPTHWISE_FILTERS],   // IN
+{% if pointwise.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                        // IN
+{% endif %}
+  unsigned short samples,                                   // IN
+  NUMBER_T output[][CONV_FILTERS]) {                        // OUT
+
+{{ separableconv.pointwise(pointwise, 'samples') }}
+}
+{{ separableconv.stage_undefs(pointwise) }}
+
+static inline void {{ node.layer.name }}(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS],                      // IN
+  const NUMBER_T depthwise_kernel[CONV_KERNEL_SIZE][DEPTHWISE_FILTERS],     // IN
+{% if depthwise.layer.use_bias %}
+  const NUMBER_T depthwise_bias[DEPTHWISE_FILTERS],                         // IN
+{% endif %}
+{% if batchnorm %}
+  const NUMBER_T batchnorm_kernel[DEPTHWISE_FILTERS],                       // IN
+  const NUMBER_T batchnorm_bias[DEPTHWISE_FILTERS],                         // IN
+{% endif %}
+  const NUMBER_T kernel[CONV_FILTERS][DEPTHWISE_FILTERS],                   // IN
+{% if pointwise.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                        // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTSAMPLES][CONV_FILTERS],                           // OUT
+  {{ node.layer.name }}_scratch_type *scratch) {                                                    // IN/OUT
+
+  unsigned short pos_x, samples;
+  NUMBER_T (*line)[DEPTHWISE_FILTERS] = scratch->line;
+
+  for (pos_x = 0; pos_x < CONV_OUTSAMPLES; pos_x += LINE_SAMPLES) {
+    samples = CONV_OUTSAMPLES - pos_x < LINE_SAMPLES ? CONV_OUTSAMPLES - pos_x : LINE_SAMPLES;
+
+    {{ node.layer.name }}_depthwise(input, depthwise_kernel, {% if depthwise.layer.use_bias %}depthwise_bias, {% endif %}pos_x, samples, line);
+{% if batchnorm %}
+    {{ node.layer.name }}_batchnorm(batchnorm_kernel, batchnorm_bias, samples, line);
+{% endif %}
+    {{ node.layer.name }}_pointwise(line, kernel, {% if pointwise.layer.use_bias %}bias, {% endif %}samples, &output[pos_x]);
+  }
+}
+
+#undef INPUT_CHANNELS
+#undef INPUT_SAMPLES
+#undef DEPTHWISE_FILTERS
+#undef DEPTHWISE_MULTIPLIER
+#undef DEPTHWISE_TILE_C
+#undef CONV_KERNEL_SIZE
+#undef ZEROPADDING_LEFT
+#undef SEPARABLE_STRIDE
+#undef CONV_FILTERS
+#undef CONV_OUTSAMPLES
+#undef CONV_TILE_X
+#undef CONV_TILE_K
+#undef SEPARABLE_INTERIOR_START
+#undef SEPARABLE_INTERIOR_END
+#undef LINE_SAMPLES
+#undef NUMBER_T
+#undef LONG_NUMBER_T
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+  * @file    separableconv2d.cc
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version V2.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+{% import 'separableconv.cc' as separableconv %}
+{% set depthwise = node.layer.depthwise %}
+{% set batchnorm = node.layer.batchnorm %}
+{% set pointwise = node.layer.pointwise %}
+{#
+  Depthwise convolution of the positions of row pos_y read by the pointwise convolution, columns of a border row all check
+  their taps against input bounds.
+#}
+{% macro depthwise_row(border) %}
+  input_y = pos_y * SEPARABLE_STRIDE_Y - ZEROPADDING_TOP;
+  pos_x = 0;
+{% if not border %}
+{% if options.interior.start[1] > 0 %}
+
+  // Border columns on the left
+  for (; pos_x < SEPARABLE_INTERIOR_START_X; pos_x += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, True, 2, 'pos_x', 'pos_x', 'SEPARABLE_INTERIOR_START_X') }}
+  }
+  pos_x = SEPARABLE_INTERIOR_START_X;
+{% endif %}
+
+  // Interior: every tap is inside input, no padding check
+  for (; pos_x + CONV_TILE_X <= SEPARABLE_INTERIOR_END_X; pos_x += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, False, 2, 'pos_x', 'pos_x', None) }}
+  }
+{% endif %}
+
+  // Border columns on the right and remaining interior columns, whole row for border rows
+  for (; pos_x < CONV_OUTWIDTH; pos_x += CONV_TILE_X) {
+{{ separableconv.depthwise_tile(depthwise, True, 2, 'pos_x', 'pos_x', 'CONV_OUTWIDTH') }}
+  }
+{% endmacro %}
+{% macro row(name) %}
+    {{ node.layer.name }}_{{ name }}(input, depthwise_kernel, {% if depthwise.layer.use_bias %}depthwise_bias, {% endif %}pos_y, line);
+{% if batchnorm %}
+    {{ node.layer.name }}_batchnorm(batchnorm_kernel, batchnorm_bias, line);
+{% endif %}
+    {{ node.layer.name }}_pointwise(line, kernel, {% if pointwise.layer.use_bias %}bias, {% endif %}output[pos_y]);
+{%- endmacro %}
+#ifndef SINGLE_FILE
+#include "{{ node.layer.name }}.h"
+#include "number.h"
+#endif
+
+#define INPUT_CHANNELS      {{ node.input_shape[0][-1] }}
+#define INPUT_HEIGHT        {{ node.input_shape[0][-3] }}
+#define INPUT_WIDTH         {{ node.input_shape[0][-2] }}
+#define DEPTHWISE_FILTERS   {{ depthwise.layer.filters }}
+#define DEPTHWISE_MULTIPLIER {{ options.depthwise.multiplier }}
+#define DEPTHWISE_TILE_C    {{ options.depthwise.tile_c }}
+#define CONV_KERNEL_SIZE_Y  {{ depthwise.layer.kernel_size[0] }}
+#define CONV_KERNEL_SIZE_X  {{ depthwise.layer.kernel_size[1] }}
+{% if depthwise.layer.padding == 'valid' %}
+#define ZEROPADDING_TOP     0
+#define ZEROPADDING_LEFT    0
+{% else %}
+#define ZEROPADDING_TOP     {{ depthwise.layer.padding[0][0] }}
+#define ZEROPADDING_LEFT    {{ depthwise.layer.padding[1][0] }}
+{% endif %}
+// Stride between the input windows of two output positions, depthwise stride x pointwise stride
+#define SEPARABLE_STRIDE_Y  {{ options.strides[0] }}
+#define SEPARABLE_STRIDE_X  {{ options.strides[1] }}
+#define CONV_FILTERS        {{ pointwise.layer.filters }}
+#define CONV_OUTHEIGHT      {{ node.output_shape[0][-3] }}
+#define CONV_OUTWIDTH       {{ node.output_shape[0][-2] }}
+#define CONV_TILE_X         {{ options.tile.x }}
+#define CONV_TILE_K         {{ options.tile.k }}
+// Range of output positions whose depthwise window is entirely inside input, computed without padding checks
+#define SEPARABLE_INTERIOR_START_Y {{ options.interior.start[0] }}
+#define SEPARABLE_INTERIOR_END_Y   {{ options.interior.end[0] }}
+#define SEPARABLE_INTERIOR_START_X {{ options.interior.start[1] }}
+#define SEPARABLE_INTERIOR_END_X   {{ options.interior.end[1] }}
+
+#define NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.width) }}
+#define LONG_NUMBER_T {{ qtype2ctype(node.q.number_type, node.q.long_width) }}
+
+// Depthwise convolution of a row to the line buffer
+{{ separableconv.stage_defines(depthwise, node.innodes[0]) }}
+{% for border in [True, False] %}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_depthwise{{ '_border' if border }}(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],                   // IN
+  const NUMBER_T kernel[CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][DEPTHWISE_FILTERS],  // IN
+{% if depthwise.layer.use_bias %}
+  const NUMBER_T bias[DEPTHWISE_FILTERS],                                            // IN
+{% endif %}
+  unsigned short pos_y,                                                              // IN
+  NUMBER_T line[CONV_OUTWIDTH][DEPTHWISE_FILTERS]) {                                 // OUT
+
+  unsigned short pos_x, k, j, t;
+  int input_y, input_x, y, x;
+{{ separableconv.depthwise_variables() }}
+{{ depthwise_row(border) }}
+}
+
+{% endfor %}
+{{ separableconv.stage_undefs(depthwise) }}
+{% if batchnorm %}
+
+// BatchNorm of the line buffer, in place
+{{ separableconv.stage_defines(batchnorm, depthwise) }}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_batchnorm(
+  const NUMBER_T kernel[DEPTHWISE_FILTERS],           // IN
+  const NUMBER_T bias[DEPTHWISE_FILTERS],             // IN
+  NUMBER_T line[CONV_OUTWIDTH][DEPTHWISE_FILTERS]) {  // IN/OUT
+
+{{ separableconv.batchnorm(batchnorm, 'CONV_OUTWIDTH') }}
+}
+{{ separableconv.stage_undefs(batchnorm) }}
+{% endif %}
+
+// Pointwise convolution of the line buffer to an output row
+{{ separableconv.stage_defines(pointwise, batchnorm if batchnorm else depthwise) }}
+X86_SIMD_DISPATCH
+static inline void {{ node.layer.name }}_pointwise(
+  const NUMBER_T line[CONV_OUTWIDTH][DEPTHWISE_FILTERS],     // IN
+  const NUMBER_T kernel[CONV_FILTERS][DEPTHWISE_FILTERS],    // IN
+{% if pointwise.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                         // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTWIDTH][CONV_FILTERS]) {            // OUT
+
+{{ separableconv.pointwise(pointwise, 'CONV_OUTWIDTH') }}
+}
+{{ separableconv.stage_undefs(pointwise) }}
+
+static inline void {{ node.layer.name }}(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],                             // IN
+  const NUMBER_T depthwise_kernel[CONV_KERNEL_SIZE_Y][CONV_KERNEL_SIZE_X][DEPTHWISE_FILTERS],  // IN
+{% if depthwise.layer.use_bias %}
+  const NUMBER_T depthwise_bias[DEPTHWISE_FILTERS],                                            // IN
+{% endif %}
+{% if batchnorm %}
+  const NUMBER_T batchnorm_kernel[DEPTHWISE_FILTERS],                                          // IN
+  const NUMBER_T batchnorm_bias[DEPTHWISE_FILTERS],                                            // IN
+{% endif %}
+  const NUMBER_T kernel[CONV_FILTERS][DEPTHWISE_FILTERS],                                      // IN
+{% if pointwise.layer.use_bias %}
+  const NUMBER_T bias[CONV_FILTERS],                                                           // IN
+{% endif %}
+  NUMBER_T output[CONV_OUTHEIGHT][CONV_OUTWIDTH][CONV_FILTERS],                                // OUT
+  {{ node.layer.name }}_scratch_type *scratch) {                                                    // IN/OUT
+
+  unsigned short pos_y;
+  NUMBER_T (*line)[DEPTHWISE_FILTERS] = scratch->line;
+
+  // Rows are split in separate loops rather than tested in the loop: compilers may predict such a test on the induction
+  // variable as never taken and optimize the interior for size
+  pos_y = 0;
+{% if options.interior.start[0] > 0 %}
+  for (; pos_y < SEPARABLE_INTERIOR_START_Y; pos_y++) { // Border rows on the top
+{{ row('depthwise_border') }}
+  }
+{% endif %}
+  for (; pos_y < SEPARABLE_INTERIOR_END_Y; pos_y++) {
+{{ row('depthwise') }}
+  }
+  for (; pos_y < CONV_OUTHEIGHT; pos_y++) { // Border rows on the bottom
+{{ row('depthwise_border') }}
+  }
+}
+
+#undef INPUT_CHANNELS
+#undef INPUT_HEIGHT
+#undef INPUT_WIDTH
+#undef DEPTHWISE_FILTERS
+#undef DEPTHWISE_MULTIPLIER
+#undef DEPTHWISE_TILE_C
+#undef CONV_KERNEL_SIZE_Y
+#undef CONV_KERNEL_SIZE_X
+#undef ZEROPADDING_TOP
+#undef ZEROPADDING_LEFT
+#undef SEPARABLE_STRIDE_Y
+#undef SEPARABLE_STRIDE_X
+#undef CONV_FILTERS
+#undef CONV_OUTHEIGHT
+#undef CONV_OUTWIDTH
+#undef CONV_TILE_X
+#undef CONV_TILE_K
+#undef SEPARABLE_INTERIOR_START_Y
+#undef SEPARABLE_INTERIOR_END_Y
+#undef SEPARABLE_INTERIOR_START_X
+#undef SEPARABLE_INTERIOR_END_X
+#undef NUMBER_T
+#undef LONG_NUMBER_T
@@ -37,10 +37,11 @@ static inline void {{ node.layer.name }}(
 {% elif node.input_shape[0] | length == 4 %}
   const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],               // IN
 {% endif %}
-  {{ node.layer.name }}_output_type output) {    // OUT
+  {{ node.layer.name }}_output_type output,    // OUT
+  {{ node.layer.name }}_scratch_type *scratch) {    // IN/OUT
   //
   size_t x, y, k;
-  static LONG_NUMBER_T output_acc[INPUT_CHANNELS];
+  LONG_NUMBER_T *output_acc = scratch->output_acc;
 
   for (k = 0; k < INPUT_CHANNELS; k++) {
     output_acc[k] = 0;
@@ -69,6 +70,33 @@ static inline void {{ node.layer.name }}(
   }
 }
 
+{% if options.sequence %}
+
+// Variable-length input: only the first samples rows of input are summed
+static inline void {{ node.layer.name }}_length(
+  const NUMBER_T input[INPUT_SAMPLES][INPUT_CHANNELS], 			      // IN
+  {{ node.layer.name }}_output_type output,    // OUT
+  {{ node.layer.name }}_scratch_type *scratch,    // IN/OUT
+  unsigned short samples) {    // IN
+  size_t x, k;
+  LONG_NUMBER_T *output_acc = scratch->output_acc;
+
+  for (k = 0; k < INPUT_CHANNELS; k++) {
+    output_acc[k] = 0;
+  }
+
+  for (x = 0; x < samples; x++) {
+    for (k = 0; k < INPUT_CHANNELS; k++) {
+      output_acc[k] += input[x][k];
+    }
+  }
+
+  for (k = 0; k < INPUT_CHANNELS; k++) {
+    output[k] = scale_and_clamp_to(NUMBER_T, output_acc[k], INPUT_SCALE_FACTOR - OUTPUT_SCALE_FACTOR, OUTPUT_ROUND_MODE);
+  }
+}
+{% endif %}
+
 {% if node.input_shape[0] | length == 3 %}
 #undef INPUT_SAMPLES
 {% elif node.input_shape[0] | length == 4 %}
@@ -62,6 +62,29 @@ static inline void {{ node.layer.name }}(
 #error "Unsupported mode {{ node.layer.mode.name }}"
 #endif
 }
+{% if options['update'] %}
+
+// Updated layer: output rows outside of [start, end) are kept from the previous frame of cnn_update()
+static inline void {{ node.layer.name }}_update(
+  const NUMBER_T input[INPUT_HEIGHT][INPUT_WIDTH][INPUT_CHANNELS],               // IN
+  {{ node.layer.name }}_output_type output,    // OUT
+  unsigned short start,  // IN
+  unsigned short end) {  // IN
+  size_t x, y, k;
+
+#ifdef MODE_NEAREST
+  for (y = start; y < end; y++) {
+    for (x = 0; x < OUTPUT_WIDTH; x++) {
+      for (k = 0; k < INPUT_CHANNELS; k++) {
+        output[y][x][k] = input[y / UPSAMPLE_SCALE_HEIGHT][x / UPSAMPLE_SCALE_WIDTH][k];
+      }
+    }
+  }
+#else
+#error "Unsupported mode {{ node.layer.mode.name }}"
+#endif
+}
+{% endif %}
 
 {% if node.input_shape[0] | length == 3 %}
 #undef INPUT_SAMPLES
@@ -17,7 +17,22 @@
 {% if node.layer.use_bias %}
 const {{ weights.bias.dtype }}  {{ node.layer.name }}_bias[CONV_FILTERS] = {{ weights.bias.data }};
 {% endif %}
+{% if options.conv_engine in ['im2col', 'winograd', 'depthwise'] %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+{% if options.conv_engine == 'im2col' %}
+// Kernel packed in panels of filters for the im2col + packed GEMM engine
+{% elif options.conv_engine == 'winograd' %}
+// Kernel transformed for Winograd convolution, [filters][transformed tile][channels]
+{% else %}
+// Kernel with filters innermost for the depthwise convolution
+{% endif %}
+const {{ packed_weights.kernel.dtype }}  {{ node.layer.name }}_kernel[{{ packed_weights.kernel.shape | join('][') }}] = {{ packed_weights.kernel.data }};
+#else
+const {{ weights.kernel.dtype }}  {{ node.layer.name }}_kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS] = {{ weights.kernel.data }};
+#endif
+{% else %}
 const {{ weights.kernel.dtype }}  {{ node.layer.name }}_kernel[CONV_FILTERS][CONV_KERNEL_SIZE][INPUT_CHANNELS / CONV_GROUPS] = {{ weights.kernel.data }};
+{% endif %}
 
 #undef INPUT_CHANNELS
 #undef CONV_FILTERS
@@ -15,7 +15,12 @@
 {% if node.layer.use_bias %}
 const {{ weights.bias.dtype }} {{ node.layer.name }}_bias[FC_UNITS] = {{ weights.bias.data }};
 {% endif %}
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+// Kernel packed in zero-padded panels of units computed in one pass over input, [panels][units][samples]
+const {{ packed_weights.kernel.dtype }} {{ node.layer.name }}_kernel[{{ packed_weights.kernel.shape | join('][') }}] = {{ packed_weights.kernel.data }};
+#else
 const {{ weights.kernel.dtype }} {{ node.layer.name }}_kernel[FC_UNITS][INPUT_SAMPLES] = {{ weights.kernel.data }};
+#endif
 
 #undef INPUT_SAMPLES
 #undef FC_UNITS
@@ -0,0 +1,29 @@
+/**
+  ******************************************************************************
+  * @file    weights/separableconv2d.cc
+  * @author  Pierre-Emmanuel Novac <penovac@unice.fr>, LEAT, CNRS, Université Côte d'Azur, France
+  * @version V2.0
+  * @date    17 october 2026
+  * @brief   Template generating plain C code for the implementation of Convolutional Neural Networks on MCU
+  */
+
+#include <stdint.h>
+
+{% if weights.depthwise_bias is defined %}
+const {{ weights.depthwise_bias.dtype }} {{ node.layer.name }}_depthwise_bias[{{ weights.depthwise_bias.shape[0] }}] = {{ weights.depthwise_bias.data }};
+
+{% endif %}
+// Depthwise kernel with filters innermost
+const {{ packed_weights.depthwise_kernel.dtype }} {{ node.layer.name }}_depthwise_kernel[{{ packed_weights.depthwise_kernel.shape | join('][') }}] = {{ packed_weights.depthwise_kernel.data }};
+
+{% if weights.batchnorm_kernel is defined %}
+const {{ weights.batchnorm_bias.dtype }} {{ node.layer.name }}_batchnorm_bias[{{ weights.batchnorm_bias.shape[0] }}] = {{ weights.batchnorm_bias.data }};
+const {{ weights.batchnorm_kernel.dtype }} {{ node.layer.name }}_batchnorm_kernel[{{ weights.batchnorm_kernel.shape[0] }}] = {{ weights.batchnorm_kernel.data }};
+
+{% endif %}
+{% if weights.bias is defined %}
+const {{ weights.bias.dtype }} {{ node.layer.name }}_bias[{{ weights.bias.shape[0] }}] = {{ weights.bias.data }};
+
+{% endif %}
+// Pointwise kernel [filters][channels]
+const {{ packed_weights.kernel.dtype }} {{ node.layer.name }}_kernel[{{ packed_weights.kernel.shape | join('][') }}] = {{ packed_weights.kernel.data }};
@@ -16,6 +16,9 @@ extern "C" {
 #ifndef SINGLE_FILE
 #include "number.h"
 #include "model.h"
+{% if schedule.task_graph or schedule.pipeline %}
+#include "parallel.h"
+{% endif %}
 // #include <chrono>
 {% if dump_featuremaps %}
   {{ featuremaps.includes() }}
@@ -28,91 +31,553 @@ extern "C" {
   {%- endif %}
 {%- endfor %}
 #endif
+{% if schedule.stream %}
 
-{% if dump_featuremaps %}
-static int sample = 0; // Track current sample
-{% endif -%}
-
-
-void cnn(
-  const input_t input,
-  {{ nodes[-1].layer.name }}_output_type {{ nodes[-1].layer.name }}_output) {
-  
-  // Output array allocation
-{%- for pool in allocation.pools %}
-  static union {
-  {%- for node in pool %}
-    {{ node.layer.name }}_output_type {{ node.layer.name }}_output;
-  {%- endfor %}
-  } activations{{ loop.index }};
-{% endfor %}
+#include <string.h>
+{% endif %}
+{% if allocation.offsets %}
 
-{% if dump_featuremaps %}
-  char path[FILENAME_MAX] = { '\0' };
-  // Prepare output file name
-  snprintf(path, FILENAME_MAX, "{{ dump_featuremaps_path }}/%d/{{ nodes[0].layer.name }}.json", sample);
-
-  // Input
-  {{ featuremaps.write(nodes, allocation, nodes[0]) }}
-{% endif -%}
+// Activations must fit in the size the arena was planned for
+{%- for node, size in allocation.sizes.items() %}
+_Static_assert(sizeof(((cnn_ctx_t *)0)->activations{{ allocation.index[node] }}.{{ node.layer.name }}_output) <= {{ size }}, "{{ node.layer.name }} output larger than planned");
+{%- endfor %}
+{% endif %}
 
-// Model layers call chain {# InputLayer is excluded #}
-{%- for node in nodes[1:] -%}  
+{#
+  Call of the layer of node with the activations of the context, converting inputs of a different number type. sample selects
+  the sample of activations allocated for mini-batches. suffix selects another function of the layer taking extra as last
+  argument, its return value is assigned to assign. Views already alias their input in the activations so nothing is called.
+#}
+{% macro call(node, index, input, output, sample='', suffix='', extra='', assign='') %}
+{%- if node in allocation.views %}
+  // {{ node.layer.name }} is a view of the output of {{ node.innodes | map(attribute='layer.name') | join(', ') }}
+{%- else %}
   {# Write function conversion if there is a type mismatch between two layer of the network #}
-  {% set outer_loop = loop %}
   {%- for innode in node.innodes -%}
     {%- if innode.q.number_type != node.q.number_type or innode.q.width != node.q.width +%}
   // TYPE WARNING for {{node.layer.name}} Innode {{innode.layer.name}} 
   // innode is {{qtype2ctype(innode.q.number_type, innode.q.width)}} type and layer is {{qtype2ctype(node.q.number_type, node.q.width)}} type
-  {{ qtype2ctype(node.q.number_type, node.q.width) }} {{innode.layer.name}}_output_convert_{{outer_loop.index}}
+  {{ qtype2ctype(node.q.number_type, node.q.width) }} {{innode.layer.name}}_output_convert_{{index}}
       {%- for dim in node.input_shape[loop.index - 1][1:] -%}
           [{{dim}}]
       {%- endfor -%};
   {{ qtype2ctype(innode.q.number_type, innode.q.width) }}_to_{{ qtype2ctype(node.q.number_type, node.q.width) }}(
       {%- if innode.layer.__class__.__name__ == 'TInputLayer' %} // Model input is passed as model parameter
-        ({{ qtype2ctype(innode.q.number_type, innode.q.width) }}*)input,
+        ({{ qtype2ctype(innode.q.number_type, innode.q.width) }}*){{ input }},
       {%- else %}
-        ({{ qtype2ctype(innode.q.number_type, innode.q.width) }}*)activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output,
+        ({{ qtype2ctype(innode.q.number_type, innode.q.width) }}*)ctx->activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output{{ sample }},
       {%- endif -%}
-        ({{ qtype2ctype(node.q.number_type, node.q.width) }}*){{innode.layer.name}}_output_convert_{{outer_loop.index}},
+        ({{ qtype2ctype(node.q.number_type, node.q.width) }}*){{innode.layer.name}}_output_convert_{{index}},
         {{ node.input_shape[loop.index - 1][1:] | join('*') }},
         {{innode.q.output_scale_factor}});
     {%- endif -%}
   {%- endfor %}
   {# type mismatch fix - end #}
-  {{ node.layer.name }}(
+  {{ assign ~ ' = ' if assign }}{{ node.layer.name }}{{ suffix }}(
     {%- for innode in node.innodes %}
       {%- if innode.q.number_type != node.q.number_type or innode.q.width != node.q.width %}
     // type warning, use instead :
-    {{innode.layer.name}}_output_convert_{{outer_loop.index}},
-    //activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output,
+    {{innode.layer.name}}_output_convert_{{index}},
+    //ctx->activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output,
       {%- elif innode.layer.__class__.__name__ == 'TInputLayer' %} // Model input is passed as model parameter
-    input,
+    {{ input }},
       {%- else %}
-    activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output,
+    ctx->activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output{{ sample }},
       {%- endif %}
     {%- endfor %}
     {%- for weights_name in node.layer.weights.keys() %}
     {{ node.layer.name}}_{{weights_name}},
     {%- endfor %}
     {%- if node != nodes[-1] %}
-    activations{{ allocation.index[node] }}.{{ node.layer.name }}_output
-    {% else -%} // Last layer uses output passed as model parameter
-    {{ node.layer.name }}_output
-    {% endif -%}
+    ctx->activations{{ allocation.index[node] }}.{{ node.layer.name }}_output{{ sample }}
+    {%- else %} // Last layer uses output passed as model parameter
+    {{ output }}
+    {%- endif %}
+    {%- if options[node].scratch %},
+    &ctx->{{ node.layer.name }}_scratch
+    {%- endif %}
+    {%- if extra %},
+    {{ extra }}
+    {%- endif %}
   );
+{%- endif %}
+{%- endmacro %}
+
+{% if dump_featuremaps %}
+static int sample = 0; // Track current sample
+{% endif -%}
+
+// Multiply-accumulate operations of each layer, cnn_step() runs layers until their sum exceeds its budget
+static const unsigned long cnn_layer_macs[MODEL_LAYERS] = { {% for node in nodes[1:] %}{{ options[node].macs }}{{ ', ' if not loop.last }}{% endfor %} };
+
+// Run a single layer of the model on one sample, layer 0 is the first one after InputLayer
+static void cnn_layer(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  output_t output,
+  unsigned short layer) {
+
+  switch (layer) {
+{% for node in nodes[1:] %}
+    case {{ loop.index0 }}: {
+{{ call(node, loop.index, 'input', 'output', '[0]' if allocation.max_batch > 1 else '') | indent(4) }}
+      break;
+    }
+{% endfor %}
+  }
+}
+
+{% if allocation.max_batch > 1 %}
+void cnn_batch_r(
+  cnn_ctx_t *ctx,
+  const input_t *inputs,
+  output_t *outputs,
+  size_t n) {
+
+  size_t start;
+  unsigned short b, batch;
+
+  // Each layer processes the whole mini-batch before the next one so that its weights are reused across samples
+  for (start = 0; start < n; start += MODEL_MAX_BATCH) {
+    batch = n - start < MODEL_MAX_BATCH ? n - start : MODEL_MAX_BATCH;
+{% for node in nodes[1:] %}
+  {%- set ns = namespace(convert=False) %}
+  {%- for innode in node.innodes %}
+    {%- if innode.q.number_type != node.q.number_type or innode.q.width != node.q.width %}
+      {%- set ns.convert = True %}
+    {%- endif %}
+  {%- endfor %}
+  {%- if node in allocation.views %}
+
+    // {{ node.layer.name }} is a view of the output of {{ node.innodes | map(attribute='layer.name') | join(', ') }}
+  {%- elif node.layer.__class__.__name__ == 'TDenseLayer' and not ns.convert %}
+
+    {{ node.layer.name }}_batch(
+    {%- for innode in node.innodes %}
+      {%- if innode.layer.__class__.__name__ == 'TInputLayer' %}
+      &inputs[start],
+      {%- else %}
+      ctx->activations{{ allocation.index[innode] }}.{{ innode.layer.name }}_output,
+      {%- endif %}
+    {%- endfor %}
+    {%- for weights_name in node.layer.weights.keys() %}
+      {{ node.layer.name}}_{{weights_name}},
+    {%- endfor %}
+    {%- if node != nodes[-1] %}
+      ctx->activations{{ allocation.index[node] }}.{{ node.layer.name }}_output,
+    {%- else %}
+      &outputs[start],
+    {%- endif %}
+    {%- if options[node].scratch %}
+      &ctx->{{ node.layer.name }}_scratch,
+    {%- endif %}
+      batch);
+  {%- else %}
+
+    for (b = 0; b < batch; b++) {
+{{ call(node, loop.index, 'inputs[start + b]', 'outputs[start + b]', '[b]') | indent(4) }}
+    }
+  {%- endif %}
+{%- endfor %}
+  }
+}
+
+void cnn_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  {{ nodes[-1].layer.name }}_output_type {{ nodes[-1].layer.name }}_output) {
+  // A single sample is a mini-batch of one
+  cnn_batch_r(ctx, (const input_t *)input, (output_t *){{ nodes[-1].layer.name }}_output, 1);
+}
+{% else %}
+{% if schedule.task_graph %}
+#ifdef WITH_THREADS
+// Layers as tasks of a graph: a layer runs once its inputs are computed and the previous users of its pool are done
+static const unsigned short cnn_task_deps[] = { {{ schedule.task_graph.deps | join(', ') }} };
+static const unsigned short cnn_task_first[] = { {{ schedule.task_graph.first | join(', ') }} };
+static const unsigned short cnn_task_successors[] = { {{ schedule.task_graph.successors | join(', ') }} };
+
+typedef struct {
+  cnn_ctx_t *ctx;
+  const void *input;
+  void *output;
+} cnn_task_args_t;
+
+static void cnn_task(void *arg, unsigned int task) {
+  const cnn_task_args_t *args = arg;
+
+  cnn_layer(args->ctx, *(const input_t *)args->input, *(output_t *)args->output, task);
+}
+#endif
+
+{% endif %}
+void cnn_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  {{ nodes[-1].layer.name }}_output_type {{ nodes[-1].layer.name }}_output) {
+{% if schedule.task_graph %}
+#ifdef WITH_THREADS
+  cnn_task_args_t args = { ctx, input, {{ nodes[-1].layer.name }}_output };
+  atomic_uint remaining[{{ nodes | length - 1 }}];
+  unsigned short tasks[PARALLEL_MAX_THREADS][{{ nodes | length - 1 }}];
+  parallel_dag_t dag = { {{ nodes | length - 1 }}, cnn_task_deps, cnn_task_first, cnn_task_successors, cnn_task, &args,
+                         remaining, tasks[0] };
+
+  parallel_dag(&dag);
+#else
+{% endif %}
+
+{% if dump_featuremaps %}
+  char path[FILENAME_MAX] = { '\0' };
+  // Prepare output file name
+  snprintf(path, FILENAME_MAX, "{{ dump_featuremaps_path }}/%d/{{ nodes[0].layer.name }}.json", sample);
+
+  // Input
+  {{ featuremaps.write(nodes, allocation, nodes[0]) }}
+{% endif -%}
+
+{% if dump_featuremaps %}
+// Model layers call chain {# InputLayer is excluded #}
+{%- for node in nodes[1:] -%}
+{{ call(node, loop.index, 'input', nodes[-1].layer.name + '_output') }}
 
-  {% if dump_featuremaps %}
   // Prepare output file name
   snprintf(path, FILENAME_MAX, "{{ dump_featuremaps_path }}/%d/{{ node.layer.name }}.json", sample);
   {{ featuremaps.write(nodes, allocation, node) }}
-  {% endif -%}
 {%- endfor %}
 
-{% if dump_featuremaps %}
   sample++; // Increment sample count
+{% else %}
+  unsigned short layer;
+
+  for (layer = 0; layer < MODEL_LAYERS; layer++) {
+    cnn_layer(ctx, input, {{ nodes[-1].layer.name }}_output, layer);
+  }
 {% endif -%}
+{% if schedule.task_graph %}
+#endif
+{% endif %}
+}
+
+void cnn_batch_r(
+  cnn_ctx_t *ctx,
+  const input_t *inputs,
+  output_t *outputs,
+  size_t n) {
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    cnn_r(ctx, inputs[i], outputs[i]);
+  }
+}
+{% endif %}
+
+{% if schedule.pipeline %}
+#ifdef WITH_THREADS
+#ifndef PIPELINE_CONTEXTS
+#define PIPELINE_CONTEXTS {{ schedule.pipeline | length + 1 }} // Samples in flight, each one has its own context
+#endif
+#if PIPELINE_CONTEXTS > PARALLEL_QUEUE_SIZE
+#error "PIPELINE_CONTEXTS cannot be larger than PARALLEL_QUEUE_SIZE"
+#endif
+
+#include <stdlib.h>
+
+// Sample streamed through the stages with the context holding all its activations, handed from a stage to the next one
+typedef struct {
+  cnn_ctx_t ctx;
+  const input_t *input;
+  output_t *output;
+} cnn_slot_t;
+
+/* Pipeline of cnn_batch(): the calling thread runs stage 0 and each other stage has its own thread. queues[s] feeds stage s,
+ * the last stage returns slots to queues[0] which holds the free ones. Slots are allocated by the first call so that builds
+ * never calling cnn_batch() do not reserve PIPELINE_CONTEXTS contexts. */
+static struct {
+  pthread_once_t once;
+  pthread_mutex_t busy;
+  int started; // All stage threads are running
+  cnn_slot_t *slots;
+  parallel_queue_t queues[{{ schedule.pipeline | length }}];
+} cnn_pipeline = { .once = PTHREAD_ONCE_INIT, .busy = PTHREAD_MUTEX_INITIALIZER };
+{% for stage in schedule.pipeline %}
+
+// Stage {{ loop.index0 }}: {{ stage | map(attribute='layer.name') | join(', ') }}
+static void cnn_stage{{ loop.index0 }}(cnn_slot_t *slot) {
+  unsigned short layer;
+
+  for (layer = {{ nodes.index(stage[0]) - 1 }}; layer < {{ nodes.index(stage[-1]) }}; layer++) {
+    cnn_layer(&slot->ctx, *slot->input, *slot->output, layer);
+  }
+}
+{% endfor %}
+
+static void (* const cnn_stages[])(cnn_slot_t *) = { {% for stage in schedule.pipeline %}cnn_stage{{ loop.index0 }}{{ ', ' if not loop.last }}{% endfor %} };
+
+static void *cnn_stage_thread(void *arg) {
+  unsigned int stage = (unsigned int)(uintptr_t)arg;
+  cnn_slot_t *slot;
+
+  for (;;) {
+    slot = parallel_queue_pop(&cnn_pipeline.queues[stage]);
+    cnn_stages[stage](slot);
+    parallel_queue_push(&cnn_pipeline.queues[(stage + 1) % {{ schedule.pipeline | length }}], slot);
+  }
+  return NULL;
+}
+
+static void cnn_pipeline_init(void) {
+  pthread_t thread;
+  unsigned int i;
+
+  // Zero-initialized like the static context of cnn(), cnn_batch() runs sequentially if they cannot be allocated
+  cnn_pipeline.slots = calloc(PIPELINE_CONTEXTS, sizeof(cnn_slot_t));
+  if (!cnn_pipeline.slots)
+    return;
+
+  for (i = 0; i < {{ schedule.pipeline | length }}; i++) {
+    parallel_queue_init(&cnn_pipeline.queues[i]);
+  }
+  for (i = 0; i < PIPELINE_CONTEXTS; i++) {
+    parallel_queue_push(&cnn_pipeline.queues[0], &cnn_pipeline.slots[i]);
+  }
+
+  // cnn_batch() runs sequentially if a stage thread cannot be created
+  for (i = 1; i < {{ schedule.pipeline | length }}; i++) {
+    if (pthread_create(&thread, NULL, cnn_stage_thread, (void *)(uintptr_t)i) != 0)
+      return;
+    pthread_detach(thread);
+  }
+  cnn_pipeline.started = 1;
+}
+#endif
+
+{% endif %}
+void cnn_begin_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  output_t output) {
+  ctx->input = (const input_t *)input;
+  ctx->output = (output_t *)output;
+  ctx->layer = 0;
+}
+
+int cnn_step_r(
+  cnn_ctx_t *ctx,
+  unsigned long macs) {
+  unsigned long done = 0;
+
+  // At least one layer per call, a layer is never interrupted
+  while (ctx->layer < MODEL_LAYERS) {
+    cnn_layer(ctx, *ctx->input, *ctx->output, ctx->layer);
+    done += cnn_layer_macs[ctx->layer];
+    ctx->layer++;
+
+    if (ctx->layer < MODEL_LAYERS && done + cnn_layer_macs[ctx->layer] > macs)
+      break;
+  }
+
+  return cnn_done_r(ctx);
+}
+
+int cnn_done_r(const cnn_ctx_t *ctx) {
+  return ctx->layer >= MODEL_LAYERS;
+}
+
+{% if schedule.stream %}
+void cnn_stream_reset_r(cnn_ctx_t *ctx) {
+  memset(ctx->stream_window, 0, sizeof(ctx->stream_window));
+  ctx->stream_primed = 0;
+}
+
+void cnn_push_r(
+  cnn_ctx_t *ctx,
+  const sample_t samples[MODEL_STREAM_HOP],
+  output_t output) {
+  unsigned short layer;
+
+  // Slide input window by MODEL_STREAM_HOP samples
+  memmove(ctx->stream_window, &ctx->stream_window[MODEL_STREAM_HOP], sizeof(sample_t) * (MODEL_INPUT_DIM_0 - MODEL_STREAM_HOP));
+  memcpy(&ctx->stream_window[MODEL_INPUT_DIM_0 - MODEL_STREAM_HOP], samples, sizeof(sample_t) * MODEL_STREAM_HOP);
+
+  // Outputs of the streamed layers are only valid once computed for a whole window
+  if (!ctx->stream_primed) {
+    for (layer = 0; layer < MODEL_LAYERS; layer++) {
+      cnn_layer(ctx, ctx->stream_window, output, layer);
+    }
+    ctx->stream_primed = 1;
+    return;
+  }
+{%- for node, shift in schedule.stream.shifts.items() %}
+{%- set activation = 'ctx->activations' ~ allocation.index[node] ~ '.' ~ node.layer.name ~ '_output' %}
+
+  // {{ node.layer.name }}: previous output shifted by {{ shift }} positions, only the last ones are computed
+  memmove({{ activation }}, &{{ activation }}[{{ shift }}], sizeof({{ activation }}[0]) * {{ node.output_shape[0][-2] - shift }});
+{{- call(node, loop.index, 'ctx->stream_window', 'output', suffix='_stream', extra=node.output_shape[0][-2] - shift) }}
+{% endfor %}
+
+  for (layer = {{ schedule.stream.shifts | length }}; layer < MODEL_LAYERS; layer++) {
+    cnn_layer(ctx, ctx->stream_window, output, layer);
+  }
+}
+
+{% endif %}
+{% if schedule.update_rows is defined %}
+void cnn_update_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  unsigned short start,
+  unsigned short end,
+  output_t output) {
+  unsigned short layer;
+  int first = start, last = end; // Changed rows [first, last) of the input of the next layer
+{%- for node, rows in schedule.update_rows.items() %}
+{%- set offset = rows.padding - rows.kernel + 1 %}
+
+  // {{ node.layer.name }}: output rows whose window reads changed rows, others are kept from the previous frame
+  if (first < last) {
+{%- if rows.scale > 1 or offset != 0 %}
+    first = first{{ ' * %d' % rows.scale if rows.scale > 1 }}{{ ' + %d' % offset if offset > 0 }}{{ ' - %d' % -offset if offset < 0 }};
+{%- endif %}
+{%- if rows.stride > 1 %}
+    first = first < 0 ? 0 : (first + {{ rows.stride - 1 }}) / {{ rows.stride }};
+    last = (last{{ ' * %d' % rows.scale if rows.scale > 1 }} - 1{{ ' + %d' % rows.padding if rows.padding > 0 }}) / {{ rows.stride }} + 1;
+{%- else %}
+{%- if offset < 0 %}
+    first = first < 0 ? 0 : first;
+{%- endif %}
+{%- if rows.scale > 1 or rows.padding > 0 %}
+    last = last{{ ' * %d' % rows.scale if rows.scale > 1 }}{{ ' + %d' % rows.padding if rows.padding > 0 }};
+{%- endif %}
+{%- endif %}
+    last = last < {{ node.output_shape[0][-3] }} ? last : {{ node.output_shape[0][-3] }};
+    if (first < last) {
+{{- call(node, loop.index, 'input', 'output', suffix='_update', extra='first, last') | indent(4) }}
+    }
+  }
+{%- endfor %}
+
+  for (layer = {{ schedule.update_rows | length }}; layer < MODEL_LAYERS; layer++) {
+    cnn_layer(ctx, input, output, layer);
+  }
+}
+
+{% endif %}
+{% if schedule.sequence is defined %}
+unsigned short cnn_sequence_r(
+  cnn_ctx_t *ctx,
+  const input_t input,
+  unsigned short samples,
+  output_t output) {
+  unsigned short length = samples < MODEL_INPUT_DIM_0 ? samples : MODEL_INPUT_DIM_0; // Valid positions of the last output
+{%- for node in schedule.sequence %}
+{%- if node.layer.__class__.__name__ == 'TSumLayer' %}
+{{ call(node, loop.index, 'input', 'output', suffix='_length', extra='length') }}
+{%- else %}
+{{ call(node, loop.index, 'input', 'output', suffix='_length', extra='length', assign='length') }}
+{%- endif %}
+{%- endfor %}
+
+  return length;
+}
+
+{% endif %}
+size_t cnn_ctx_size(void) {
+  return sizeof(cnn_ctx_t);
+}
+
+// Context of cnn() and cnn_batch()
+static cnn_ctx_t cnn_ctx;
+
+void cnn(
+  const input_t input,
+  {{ nodes[-1].layer.name }}_output_type {{ nodes[-1].layer.name }}_output) {
+  cnn_r(&cnn_ctx, input, {{ nodes[-1].layer.name }}_output);
+}
+
+void cnn_batch(
+  const input_t *inputs,
+  output_t *outputs,
+  size_t n) {
+{% if schedule.pipeline %}
+#ifdef WITH_THREADS
+  cnn_slot_t *slots[PIPELINE_CONTEXTS];
+  cnn_slot_t *slot;
+  size_t i;
+
+  pthread_once(&cnn_pipeline.once, cnn_pipeline_init);
+  if (cnn_pipeline.started) {
+    pthread_mutex_lock(&cnn_pipeline.busy);
+
+    // Sample i + 1 enters the first stage while the next stages still process the previous samples
+    for (i = 0; i < n; i++) {
+      slot = parallel_queue_pop(&cnn_pipeline.queues[0]);
+      slot->input = &inputs[i];
+      slot->output = &outputs[i];
+      cnn_stage0(slot);
+      parallel_queue_push(&cnn_pipeline.queues[1], slot);
+    }
+
+    // All samples are done once every slot is back in the free queue
+    for (i = 0; i < PIPELINE_CONTEXTS; i++) {
+      slots[i] = parallel_queue_pop(&cnn_pipeline.queues[0]);
+    }
+    for (i = 0; i < PIPELINE_CONTEXTS; i++) {
+      parallel_queue_push(&cnn_pipeline.queues[0], slots[i]);
+    }
+
+    pthread_mutex_unlock(&cnn_pipeline.busy);
+    return;
+  }
+#endif
+{% endif %}
+  cnn_batch_r(&cnn_ctx, inputs, outputs, n);
+}
+
+void cnn_begin(
+  const input_t input,
+  output_t output) {
+  cnn_begin_r(&cnn_ctx, input, output);
+}
+
+int cnn_step(unsigned long macs) {
+  return cnn_step_r(&cnn_ctx, macs);
+}
+
+int cnn_done(void) {
+  return cnn_done_r(&cnn_ctx);
+}
+{% if schedule.sequence is defined %}
+
+unsigned short cnn_sequence(
+  const input_t input,
+  unsigned short samples,
+  output_t output) {
+  return cnn_sequence_r(&cnn_ctx, input, samples, output);
+}
+{% endif %}
+{% if schedule.update_rows is defined %}
+
+void cnn_update(
+  const input_t input,
+  unsigned short start,
+  unsigned short end,
+  output_t output) {
+  cnn_update_r(&cnn_ctx, input, start, end, output);
+}
+{% endif %}
+{% if schedule.stream %}
+
+void cnn_stream_reset(void) {
+  cnn_stream_reset_r(&cnn_ctx);
+}
+
+void cnn_push(
+  const sample_t samples[MODEL_STREAM_HOP],
+  output_t output) {
+  cnn_push_r(&cnn_ctx, samples, output);
 }
+{% endif %}
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,30 @@
+{#
+  Intra-layer multithreading of layers with options.parallel when built with WITH_THREADS. The layer computes its output in the
+  range function {{ node.layer.name }}_range(args…, start, end) over output rows, positions, units or channels; ranges are
+  computed by the threads of the pool from parallel.h. Without WITH_THREADS the range function is called once for the whole
+  output.
+#}
+
+{#
+  Task of the pool calling the range function with the arguments of the layer passed as an array of pointers.
+#}
+{% macro task(node, args) %}
+#ifdef WITH_THREADS
+static void {{ node.layer.name }}_task(void * const args[], unsigned int start, unsigned int end) {
+  {{ node.layer.name }}_range({% for arg in args %}args[{{ loop.index0 }}], {% endfor %}start, end);
+}
+#endif
+{%- endmacro %}
+
+{#
+  Body of the layer function computing the n elements of output in chunks of whole grains.
+#}
+{% macro run(node, args) %}
+#ifdef WITH_THREADS
+  void * const args[] = { {% for arg in args %}(void *){{ arg }}{{ ', ' if not loop.last }}{% endfor %} };
+
+  parallel_for({{ node.layer.name }}_task, args, {{ options.parallel.n }}, {{ options.parallel.grain }});
+#else
+  {{ node.layer.name }}_range({{ args | join(', ') }}, 0, {{ options.parallel.n }});
+#endif
+{%- endmacro %}
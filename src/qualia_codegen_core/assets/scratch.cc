@@ -0,0 +1,40 @@
+{#
+  Scratch buffers of a layer, allocated in the model context cnn_ctx_t and passed to the layer function. portable and cmsis are
+  lists of member declarations for the portable kernels and for CMSIS-NN/NMSIS-NN, a configuration without buffer still needs
+  a member.
+#}
+{% macro typedef(node, portable, cmsis=[]) %}
+// Scratch buffers of {{ node.layer.name }}, part of the model context
+typedef struct {
+#if !defined(WITH_CMSIS_NN) && !defined(WITH_NMSIS_NN)
+{% for member in portable %}
+  {{ member }};
+{% else %}
+  char unused;
+{% endfor %}
+#else
+{% for member in cmsis %}
+  {{ member }};
+{% else %}
+  char unused;
+{% endfor %}
+#endif
+} {{ node.layer.name }}_scratch_type;
+{% endmacro %}
+
+{#
+  Scratch buffers of convolution layers: im2col or Winograd transformed input buffer of the portable engines, buffer_a elements
+  of bufferA for 8-bit and 16-bit CMSIS-NN/NMSIS-NN functions. Needs to be imported with context for qtype2ctype.
+#}
+{% macro conv_typedef(node, options, buffer_a) %}
+{%- set number_t = qtype2ctype(node.q.number_type, node.q.width) %}
+{%- set long_number_t = qtype2ctype(node.q.number_type, node.q.long_width) %}
+{%- if options.conv_engine == 'im2col' and options.gemm.im2col %}
+{%- set portable = [number_t ~ ' im2col_buffer[' ~ options.gemm.rows ~ '][' ~ options.gemm.k ~ ']'] %}
+{%- elif options.conv_engine == 'winograd' %}
+{%- set portable = [long_number_t ~ ' winograd_buffer[' ~ options.winograd.block ~ '][' ~ options.winograd.points ~ '][' ~ node.input_shape[0][-1] ~ ']'] %}
+{%- else %}
+{%- set portable = [] %}
+{%- endif %}
+{{ typedef(node, portable, ['int16_t bufferA[' ~ buffer_a ~ ']'] if number_t in ['int8_t', 'int16_t'] else []) }}
+{%- endmacro %}
@@ -0,0 +1,164 @@
+{#
+  Fused depthwise convolution → (BatchNorm) → pointwise convolution shared by separable convolution layers.
+
+  Depthwise output is computed in a line buffer line[positions][DEPTHWISE_FILTERS] holding only the positions read by the
+  pointwise convolution, the whole intermediate tensor is never stored. Each stage defines its own activation and fixed-point
+  scale factors around its function with stage_defines/stage_undefs, all stages share NUMBER_T and LONG_NUMBER_T.
+  Depthwise kernel is packed as [K…][DEPTHWISE_FILTERS], pointwise kernel as [CONV_FILTERS][DEPTHWISE_FILTERS].
+#}
+{% import 'gemm.cc' as gemm %}
+
+{#
+  Activation and fixed-point scale factors of a stage of the fused layer, input of the stage is the output of innode.
+#}
+{% macro stage_defines(stage, innode) %}
+#define ACTIVATION_{{ stage.layer.activation.name | upper }}
+#define WEIGHTS_SCALE_FACTOR {{ stage.q.weights_scale_factor }}
+#define BIASES_SCALE_FACTOR {{ stage.q.bias_scale_factor if stage.q.bias_scale_factor is not none else stage.q.weights_scale_factor }}
+#define TMP_SCALE_FACTOR {{ [stage.q.weights_scale_factor, stage.q.bias_scale_factor] | max if stage.q.bias_scale_factor is not none else stage.q.weights_scale_factor }}
+#define INPUT_SCALE_FACTOR {{ innode.q.output_scale_factor }}
+#define OUTPUT_SCALE_FACTOR {{ stage.q.output_scale_factor }}
+#define OUTPUT_ROUND_MODE ROUND_MODE_{{ stage.q.output_round_mode | upper }}
+{% endmacro %}
+
+{% macro stage_undefs(stage) %}
+#undef ACTIVATION_{{ stage.layer.activation.name | upper }}
+#undef WEIGHTS_SCALE_FACTOR
+#undef BIASES_SCALE_FACTOR
+#undef TMP_SCALE_FACTOR
+#undef INPUT_SCALE_FACTOR
+#undef OUTPUT_SCALE_FACTOR
+#undef OUTPUT_ROUND_MODE
+{% endmacro %}
+
+{% macro depthwise_variables() %}
+  LONG_NUMBER_T acc[CONV_TILE_X][DEPTHWISE_TILE_C];
+  LONG_NUMBER_T output_acc;
+  const NUMBER_T *in[CONV_TILE_X];
+  static const NUMBER_T zeros[INPUT_CHANNELS] = { 0 };
+{% endmacro %}
+
+{#
+  Depthwise tile of CONV_TILE_X positions starting at line index pos, output position input_pos, to the line buffer, by tiles
+  of DEPTHWISE_TILE_C channels vectorized in channels_last order. Border tiles check each tap against input bounds, line
+  indices from limit are not computed. Row of the window starts at input_y for Conv2D.
+#}
+{% macro depthwise_tile(node, border, dims, pos, input_pos, limit) %}
+      for (k = 0; k < DEPTHWISE_FILTERS; k += DEPTHWISE_TILE_C) {
+        for (t = 0; t < CONV_TILE_X; t++) {
+          for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+            acc[t][j] = 0;
+          }
+        }
+
+{% if dims == 2 %}
+        for (y = 0; y < CONV_KERNEL_SIZE_Y; y++) {
+          for (x = 0; x < CONV_KERNEL_SIZE_X; x++) {
+            for (t = 0; t < CONV_TILE_X; t++) {
+              input_x = ({{ input_pos }} + t) * SEPARABLE_STRIDE_X - ZEROPADDING_LEFT + x;
+{% if border %}
+              if ({{ pos }} + t >= {{ limit }} || input_x < 0 || input_x >= INPUT_WIDTH || input_y + y < 0 || input_y + y >= INPUT_HEIGHT)
+                in[t] = zeros;
+              else
+                in[t] = input[input_y + y][input_x];
+{% else %}
+              in[t] = input[input_y + y][input_x];
+{% endif %}
+            }
+
+            // Channels innermost, contiguous in input, packed kernel and line buffer
+            for (t = 0; t < CONV_TILE_X; t++) {
+              for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+                acc[t][j] += (LONG_NUMBER_T)in[t][(k + j) / DEPTHWISE_MULTIPLIER] * (LONG_NUMBER_T)kernel[y][x][k + j];
+              }
+            }
+          }
+        }
+{% else %}
+        for (x = 0; x < CONV_KERNEL_SIZE; x++) {
+          for (t = 0; t < CONV_TILE_X; t++) {
+            input_x = ({{ input_pos }} + t) * SEPARABLE_STRIDE - ZEROPADDING_LEFT + x;
+{% if border %}
+            if ({{ pos }} + t >= {{ limit }} || input_x < 0 || input_x >= INPUT_SAMPLES)
+              in[t] = zeros;
+            else
+              in[t] = input[input_x];
+{% else %}
+            in[t] = input[input_x];
+{% endif %}
+          }
+
+          // Channels innermost, contiguous in input, packed kernel and line buffer
+          for (t = 0; t < CONV_TILE_X; t++) {
+            for (j = 0; j < DEPTHWISE_TILE_C; j++) {
+              acc[t][j] += (LONG_NUMBER_T)in[t][(k + j) / DEPTHWISE_MULTIPLIER] * (LONG_NUMBER_T)kernel[x][k + j];
+            }
+          }
+        }
+{% endif %}
+
+        for (t = 0; t < CONV_TILE_X{% if border %} && {{ pos }} + t < {{ limit }}{% endif %}; t++) {
+{{ gemm.tile_epilogue(node, 'acc[t]', 'DEPTHWISE_TILE_C', 'DEPTHWISE_TILE_C', '&line[' ~ pos ~ ' + t][k]', 'line[' ~ pos ~ ' + t][k + j]') }}
+        }
+      }
+{%- endmacro %}
+
+{#
+  BatchNorm of the first positions of the line buffer, in place.
+#}
+{% macro batchnorm(node, positions) %}
+  unsigned short x, k;
+  LONG_NUMBER_T output_acc;
+
+  for (x = 0; x < {{ positions }}; x++) {
+    for (k = 0; k < DEPTHWISE_FILTERS; k++) {
+      output_acc = (LONG_NUMBER_T)line[x][k] * (LONG_NUMBER_T)kernel[k];
+{{ gemm.epilogue(node, 'line[x][k]') }}
+    }
+  }
+{% endmacro %}
+
+{#
+  Tile of n positions starting at x x all filters of the pointwise convolution, channels innermost.
+#}
+{% macro pointwise_tile(node, n) %}
+    for (k = 0; k < CONV_FILTERS; k += CONV_TILE_K) {
+      for (i = 0; i < CONV_TILE_X; i++) {
+        for (j = 0; j < CONV_TILE_K; j++) {
+          acc[i][j] = 0;
+        }
+      }
+
+      // Channels innermost, contiguous in both line buffer and kernel
+      for (z = 0; z < DEPTHWISE_FILTERS; z++) {
+        for (i = 0; i < {{ n }}; i++) {
+          for (j = 0; j < CONV_TILE_K; j++) {
+            acc[i][j] += (LONG_NUMBER_T)line[x + i][z] * (LONG_NUMBER_T)kernel[k + j][z];
+          }
+        }
+      }
+
+      for (i = 0; i < {{ n }}; i++) {
+{{ gemm.tile_epilogue(node, 'acc[i]', 'CONV_TILE_K', 'CONV_TILE_K', '&output[x + i][k]', 'output[x + i][k + j]') }}
+      }
+    }
+{%- endmacro %}
+
+{#
+  Pointwise convolution of the first positions of the line buffer to output. Remaining positions are computed after the
+  loop of complete tiles rather than tested in the loop: compilers may predict such a test as never taken.
+#}
+{% macro pointwise(node, positions) %}
+  unsigned short x, k, z, i, j, remaining;
+  LONG_NUMBER_T acc[CONV_TILE_X][CONV_TILE_K];
+  LONG_NUMBER_T output_acc;
+
+  for (x = 0; x + CONV_TILE_X <= {{ positions }}; x += CONV_TILE_X) {
+{{ pointwise_tile(node, 'CONV_TILE_X') }}
+  }
+
+  if (x < {{ positions }}) { // Remaining positions
+    remaining = {{ positions }} - x;
+{{ pointwise_tile(node, 'remaining') }}
+  }
+{% endmacro %}
@@ -0,0 +1,120 @@
+{#
+  Winograd minimal filtering F(m, 3) and F(m x m, 3 x 3) shared by the portable path of convolution layers.
+
+  Output is computed per tile of WINOGRAD_M (x WINOGRAD_M) output positions from WINOGRAD_ALPHA (x WINOGRAD_ALPHA) input
+  samples as Y = A^T [U * V] (A for Conv2D) with V = B^T d (B for Conv2D) the transformed input tile and U the kernel transformed
+  at code generation time: kernel[CONV_FILTERS][WINOGRAD_POINTS][INPUT_CHANNELS]. The element-wise product is summed over
+  channels, it costs WINOGRAD_POINTS multiplications per tile and filter instead of the size of the tile x the kernel size.
+  Transformed input of a block of WINOGRAD_BLOCK tiles is kept in the scratch buffer of the layer, sized at code generation time.
+  Fixed-point kernel transform is scaled to integers, the result of the output transform is divided by WINOGRAD_SCALE.
+#}
+
+{% macro defines(winograd) %}
+#define WINOGRAD_M          {{ winograd.m }}
+#define WINOGRAD_ALPHA      {{ winograd.alpha }}
+#define WINOGRAD_POINTS     {{ winograd.points }}
+#define WINOGRAD_TILES_X    {{ winograd.tiles[-1] }}
+#define WINOGRAD_TILES      {{ winograd.tiles | join(' * ') }}
+#define WINOGRAD_BLOCK      {{ winograd.block }}
+#define WINOGRAD_SCALE      {{ winograd.scale }}
+{% endmacro %}
+
+{% macro undefs() %}
+#undef WINOGRAD_M
+#undef WINOGRAD_ALPHA
+#undef WINOGRAD_POINTS
+#undef WINOGRAD_TILES_X
+#undef WINOGRAD_TILES
+#undef WINOGRAD_BLOCK
+#undef WINOGRAD_SCALE
+{% endmacro %}
+
+{#
+  Linear combination of terms with the coefficients of a transform matrix row, term j is fmt formatted with offset + j * stride.
+  Null coefficients are skipped.
+#}
+{% macro lincomb(row, fmt, offset=0, stride=1) -%}
+{%- set ns = namespace(first=True) -%}
+{%- for c in row -%}
+{%- if c != 0 -%}
+{%- set term = fmt | format(offset + loop.index0 * stride) -%}
+{%- if ns.first -%}
+{{ '-' if c < 0 }}{{ (c | abs) ~ ' * ' if c | abs != 1 }}{{ term }}
+{%- else -%}
+{{ ' - ' if c < 0 else ' + ' }}{{ (c | abs) ~ ' * ' if c | abs != 1 }}{{ term }}
+{%- endif -%}
+{%- set ns.first = False -%}
+{%- endif -%}
+{%- endfor -%}
+{%- endmacro %}
+
+{% macro variables() %}
+  unsigned int t0, t, tiles;
+  unsigned short k, e, z, i;
+  LONG_NUMBER_T acc[WINOGRAD_POINTS];
+  LONG_NUMBER_T output_acc;
+  // Input samples of a tile, samples outside of input (padding or past the end of input for the last tile) point to zeros
+  const NUMBER_T *in[WINOGRAD_POINTS];
+  static const NUMBER_T zeros[INPUT_CHANNELS] = { 0 };
+  // Transformed input of a block of tiles, channels innermost
+  LONG_NUMBER_T (*winograd_buffer)[WINOGRAD_POINTS][INPUT_CHANNELS] = scratch->winograd_buffer;
+{% endmacro %}
+
+{#
+  Input transform of tile t from the in[] sample pointers, for each channel. Conv2D applies B^T on columns then B on rows.
+#}
+{% macro input_transform(winograd, dims) %}
+      for (z = 0; z < INPUT_CHANNELS; z++) {
+{%- if dims == 2 %}
+{%- for i in range(winograd.alpha) %}
+{%- for b in range(winograd.alpha) %}
+        tmp[{{ i }}][{{ b }}] = {{ lincomb(winograd.bt[i], '(LONG_NUMBER_T)in[%d][z]', b, winograd.alpha) }};
+{%- endfor %}
+{%- endfor %}
+{%- for i in range(winograd.alpha) %}
+{%- for j in range(winograd.alpha) %}
+        winograd_buffer[t][{{ i * winograd.alpha + j }}][z] = {{ lincomb(winograd.bt[j], 'tmp[' ~ i ~ '][%d]') }};
+{%- endfor %}
+{%- endfor %}
+{%- else %}
+{%- for i in range(winograd.alpha) %}
+        winograd_buffer[t][{{ i }}][z] = {{ lincomb(winograd.bt[i], '(LONG_NUMBER_T)in[%d][z]') }};
+{%- endfor %}
+{%- endif %}
+      }
+{% endmacro %}
+
+{#
+  Element-wise product of transformed input of tile t and transformed kernel of filter k, summed over channels.
+#}
+{% macro product() %}
+        for (e = 0; e < WINOGRAD_POINTS; e++) {
+          acc[e] = 0;
+          for (z = 0; z < INPUT_CHANNELS; z++) {
+            acc[e] += winograd_buffer[t][e][z] * kernel[k][e][z];
+          }
+        }
+{% endmacro %}
+
+{#
+  Output transform of acc[] to y[]. Conv2D applies A^T on columns then A on rows.
+#}
+{% macro output_transform(winograd, dims) %}
+{%- set div = ' / WINOGRAD_SCALE' if winograd.scale != 1 else '' %}
+{%- if dims == 2 %}
+{%- for i in range(winograd.m) %}
+{%- for b in range(winograd.alpha) %}
+        tmp[{{ i }}][{{ b }}] = {{ lincomb(winograd.at[i], 'acc[%d]', b, winograd.alpha) }};
+{%- endfor %}
+{%- endfor %}
+{%- for i in range(winograd.m) %}
+{%- for j in range(winograd.m) %}
+        y[{{ i }}][{{ j }}] = ({{ lincomb(winograd.at[j], 'tmp[' ~ i ~ '][%d]') }}){{ div }};
+{%- endfor %}
+{%- endfor %}
+{%- else %}
+{%- for i in range(winograd.m) %}
+        y[{{ i }}] = ({{ lincomb(winograd.at[i], 'acc[%d]') }}){{ div }};
+{%- endfor %}
+{%- endif %}
+{% endmacro %}
@@ -35,9 +35,8 @@ template<size_t InputDims, size_t OutputDims>
 void evaluate(const std::vector<std::array<float, InputDims>> &inputs, const std::vector<std::array<float, OutputDims>> &targets) {
 	static NeuralNetwork nn{metrics};
 
-	for (size_t i = 0;  i < inputs.size() ; i++){ //&& i < labels.size()-1000; i++) {
-		nn.evaluate(inputs.at(i), targets.at(i));
-	}
+	// Whole dataset in mini-batches, each weight is loaded once per mini-batch
+	nn.evaluate_batch(inputs.data(), targets.data(), std::min(inputs.size(), targets.size()));
 
 	auto metrics_result = nn.getMetricsResult();
 
@@ -0,0 +1,59 @@
+// Copyright 2021 (c) Pierre-Emmanuel Novac <penovac@unice.fr> Université Côte d'Azur, CNRS, LEAT. All rights reserved.
+
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "NeuralNetwork.h"
+#include "link.h"
+
+// Head of a split model: runs the first layers on each test vector and sends their output to the tail, on the standard output or
+// to the Unix domain socket the tail listens on
+int main(int argc, const char *argv[]) {
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " testX.csv [socket]" << std::endl;
+		exit(1);
+	}
+
+	int fd = argc == 3 ? link_connect(argv[2]) : STDOUT_FILENO;
+	if (fd < 0) {
+		std::cerr << "Cannot connect to " << argv[2] << std::endl;
+		exit(1);
+	}
+
+	static std::array<float, MODEL_INPUT_DIMS> input;
+	static output_t output;
+	static unsigned char frame[LINK_FRAME_SIZE];
+	size_t frames = 0;
+	size_t bytes = 0;
+
+	std::ifstream fin(argv[1]);
+	std::string linestr;
+	while (std::getline(fin, linestr)) {
+		std::istringstream linestrs(linestr);
+		std::string floatstr;
+		input.fill(0);
+		for (size_t i = 0; i < input.size() && std::getline(linestrs, floatstr, ','); i++) {
+			input.at(i) = std::strtof(floatstr.c_str(), NULL);
+		}
+
+		neuralNetworkRun(input.data(), output);
+
+		// Zeros of ReLU outputs are run-length encoded
+		size_t size = link_encode(reinterpret_cast<const LINK_NUMBER_T *>(output), frame, 1);
+		if (link_send(fd, frame, size) < 0) {
+			std::cerr << "Cannot send frame " << frames << std::endl;
+			exit(1);
+		}
+		frames++;
+		bytes += size;
+	}
+
+	std::cerr << "frames=" << frames << " bytes=" << bytes << " raw=" << frames * LINK_FRAME_SIZE << std::endl;
+
+	close(fd);
+	return 0;
+}
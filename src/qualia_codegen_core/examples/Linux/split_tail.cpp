@@ -0,0 +1,70 @@
+// Copyright 2021 (c) Pierre-Emmanuel Novac <penovac@unice.fr> Université Côte d'Azur, CNRS, LEAT. All rights reserved.
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include "model.h"
+#include "link.h"
+
+// Tail of a split model: receives the output of the head for each test vector, on the standard input or from a Unix domain
+// socket, runs the last layers and compares the predicted class with the label
+int main(int argc, const char *argv[]) {
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " testY.csv [socket]" << std::endl;
+		exit(1);
+	}
+
+	std::ifstream fin(argv[1]);
+
+	int fd = argc == 3 ? link_listen(argv[2]) : STDIN_FILENO;
+	if (fd < 0) {
+		std::cerr << "Cannot listen on " << argv[2] << std::endl;
+		exit(1);
+	}
+
+	static input_t input;
+	static output_t output;
+	static unsigned char frame[LINK_FRAME_SIZE];
+	size_t frames = 0;
+	size_t correct = 0;
+	long size;
+
+	while ((size = link_receive(fd, frame)) > 0) {
+		if (link_decode(frame, static_cast<size_t>(size), reinterpret_cast<LINK_NUMBER_T *>(input)) < 0) {
+			std::cerr << "Malformed frame " << frames << std::endl;
+			exit(1);
+		}
+
+		cnn(input, output);
+
+		std::string linestr;
+		std::array<float, MODEL_OUTPUT_SAMPLES> label{};
+		if (std::getline(fin, linestr)) {
+			std::istringstream linestrs(linestr);
+			std::string floatstr;
+			for (size_t i = 0; i < label.size() && std::getline(linestrs, floatstr, ','); i++) {
+				label.at(i) = std::strtof(floatstr.c_str(), NULL);
+			}
+		}
+
+		auto pred = std::distance(std::begin(output), std::max_element(std::begin(output), std::end(output)));
+		auto target = std::distance(label.begin(), std::max_element(label.begin(), label.end()));
+		correct += pred == target;
+		frames++;
+	}
+	if (size < 0) {
+		std::cerr << "Cannot receive frame " << frames << std::endl;
+		exit(1);
+	}
+
+	std::cerr << "acc=" << (frames ? static_cast<float>(correct) / frames : 0.0f) << std::endl;
+
+	close(fd);
+	return 0;
+}
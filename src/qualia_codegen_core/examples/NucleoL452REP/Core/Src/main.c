@@ -35,6 +35,7 @@
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
 #define MAX_READ_SIZE 16384 // Absolute max is 65535 due to HAL_UART_Receive_DMA size being uint16_t
+#define NN_STEP_MACS 20000 // Multiply-accumulate operations of the inference run between two iterations of the main loop
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -141,9 +142,11 @@ int main(void)
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
+  int inferring = 0;
+  uint32_t start = 0;
   while (1)
   {
-    if (receive_buff_cnt > 0 && receive_buff[receive_buff_cnt - 1] == '\n') {
+    if (!inferring && receive_buff_cnt > 0 && receive_buff[receive_buff_cnt - 1] == '\n') {
       float *inputs = serialBufToFloats(receive_buff, receive_buff_cnt);
       size_t len = snprintf(send_msg, 32, "%d\r\n", receive_buff_cnt);
       receive_buff_cnt = 0;
@@ -151,11 +154,18 @@ int main(void)
 
       HAL_UART_Transmit(&huart2, (unsigned char *)send_msg, len, 0x200);
 
-      uint32_t start = getCurrentMicros();
-      struct NNResult res = neuralNetworkInfer(inputs);
+      start = getCurrentMicros();
+      neuralNetworkBegin(inputs);
+      inferring = 1;
+    }
+
+    // Inference runs a few layers per iteration so that the loop keeps handling I/O
+    if (inferring && neuralNetworkStep(NN_STEP_MACS)) {
       uint32_t stop = getCurrentMicros();
+      struct NNResult res = neuralNetworkResult();
+      inferring = 0;
 
-      len = snprintf(send_msg, 32, "%d,%d,%f,%lu\r\n", res.inference_count, res.label, (double)res.dist, stop - start);
+      size_t len = snprintf(send_msg, 32, "%d,%d,%f,%lu\r\n", res.inference_count, res.label, (double)res.dist, stop - start);
       HAL_UART_Transmit(&huart2, (unsigned char *)send_msg, len, 0x200);
     }
     /* USER CODE END WHILE */
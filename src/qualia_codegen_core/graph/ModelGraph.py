@@ -86,6 +86,19 @@ class ModelGraph:
         self.add_node(newnode, oldnode.innodes, oldnode.outnodes)
         self.delete_node(oldnode)
 
+    # Replace a chain of nodes, each one the only input of the next one, by a single node at the location of the last one
+    def fuse_nodes(self, nodes: list[LayerNode], newnode: LayerNode) -> None:
+        newnode.innodes = list(nodes[0].innodes)
+        newnode.outnodes = list(nodes[-1].outnodes)
+        for innode in newnode.innodes:
+            innode.outnodes[innode.outnodes.index(nodes[0])] = newnode
+        for outnode in newnode.outnodes:
+            outnode.innodes[outnode.innodes.index(nodes[-1])] = newnode
+
+        self.__nodes.insert(self.__nodes.index(nodes[-1]), newnode)
+        for node in nodes:
+            self.__nodes.remove(node)
+
     def find_node_from_layer(self, layer: TBaseLayer) -> LayerNode | None:
         nodes = [node for node in self.nodes if node.layer is layer]
         if len(nodes) == 0:
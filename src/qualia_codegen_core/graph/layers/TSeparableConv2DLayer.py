@@ -0,0 +1,8 @@
+from dataclasses import dataclass
+
+from .TSeparableConvLayer import TSeparableConvLayer
+
+
+@dataclass
+class TSeparableConv2DLayer(TSeparableConvLayer):
+    pass
@@ -0,0 +1,39 @@
+from __future__ import annotations
+
+import sys
+from dataclasses import dataclass
+
+from qualia_codegen_core.typing import TYPE_CHECKING, NDArrayFloatOrInt
+
+from .TBaseLayer import TBaseLayer
+
+if TYPE_CHECKING:
+    from collections import OrderedDict
+
+    from qualia_codegen_core.graph.LayerNode import LayerNode
+
+if sys.version_info >= (3, 12):
+    from typing import override
+else:
+    from typing_extensions import override
+
+@dataclass
+class TSeparableConvLayer(TBaseLayer):
+    """Depthwise convolution followed by an optional BatchNorm and a pointwise convolution, executed as a single layer.
+
+    Built by the Converter after quantization, the fused nodes keep their own weights and quantization information.
+    """
+
+    depthwise: LayerNode
+    batchnorm: LayerNode | None
+    pointwise: LayerNode
+
+    @property
+    @override
+    def weights(self) -> OrderedDict[str, NDArrayFloatOrInt]:
+        w = super().weights
+        w.update((f'depthwise_{name}', arr) for name, arr in self.depthwise.layer.weights.items())
+        if self.batchnorm is not None:
+            w.update((f'batchnorm_{name}', arr) for name, arr in self.batchnorm.layer.weights.items())
+        w.update(self.pointwise.layer.weights)
+        return w
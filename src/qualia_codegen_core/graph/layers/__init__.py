@@ -21,6 +21,9 @@ from .TMaxPooling2DLayer import TMaxPooling2DLayer
 from .TMaxPoolingLayer import TMaxPoolingLayer
 from .TPermuteLayer import TPermuteLayer
 from .TSampleNormLayer import TSampleNormLayer
+from .TSeparableConv1DLayer import TSeparableConv1DLayer
+from .TSeparableConv2DLayer import TSeparableConv2DLayer
+from .TSeparableConvLayer import TSeparableConvLayer
 from .TSliceLayer import TSliceLayer
 from .TSumLayer import TSumLayer
 from .TUpsampleLayer import TUpsampleLayer
@@ -52,6 +55,9 @@ layers_t = {
     'TMaxPoolingLayer': TMaxPoolingLayer,
     'TPermuteLayer': TPermuteLayer,
     'TSampleNormLayer': TSampleNormLayer,
+    'TSeparableConv1DLayer': TSeparableConv1DLayer,
+    'TSeparableConv2DLayer': TSeparableConv2DLayer,
+    'TSeparableConvLayer': TSeparableConvLayer,
     'TSliceLayer': TSliceLayer,
     'TSumLayer': TSumLayer,
     'TUpsampleLayer': TUpsampleLayer,
@@ -84,6 +90,9 @@ __all__ = [
         'TMaxPoolingLayer',
         'TPermuteLayer',
         'TSampleNormLayer',
+        'TSeparableConv1DLayer',
+        'TSeparableConv2DLayer',
+        'TSeparableConvLayer',
         'TSliceLayer',
         'TSumLayer',
         'TUpsampleLayer',
@@ -4,6 +4,7 @@
 # April 29, 2021
 from __future__ import annotations
 
+import argparse
 import copy
 import logging
 import sys
@@ -13,9 +14,12 @@ from qualia_codegen_core import Converter
 from qualia_codegen_core.graph import ModelGraph, Quantization
 from qualia_codegen_core.graph.ActivationsRange import ActivationsRange
 from qualia_codegen_core.graph.RoundMode import RoundMode
+from qualia_codegen_core.KernelSelector import KernelSelector
 from qualia_codegen_core.typing import TYPE_CHECKING
 
 if TYPE_CHECKING:
+    from typing import Any
+
     from qualia_codegen_core.graph.ActivationRange import ActivationRange
 
 logger = logging.getLogger(__name__)
@@ -144,7 +148,8 @@ def qualia_codegen(filename: str,
                quantize: str = 'float32',
                activations_range_file: str = '',
                module_name: str = '', # PyTorch module name
-               *args: str) -> str | bool: # PyTorch module args
+               *args: str, # PyTorch module args
+               **converter_options: Any) -> str | bool: # noqa: ANN401 Converter keyword arguments of any type
     filepath = Path(filename)
     fname = filepath.stem
 
@@ -177,7 +182,7 @@ def qualia_codegen(filename: str,
     if not annotate_quantization(modelgraph, activations_range, number_type, width, long_width):
         return False
 
-    converter = Converter(output_path=Path('out')/'qualia_codegen'/fname)
+    converter = Converter(output_path=Path('out')/'qualia_codegen'/fname, **converter_options)
 
     fullmodel_h = converter.convert_model(modelgraph)
 
@@ -188,14 +193,55 @@ def qualia_codegen(filename: str,
     return fullmodel_h
 
 def main() -> int:
-    if len(sys.argv) < 2:  # noqa: PLR2004 # Only required arg is weights file
-        logger.error('Usage: %s <weights_file>'
-                     ' [quantization] [activations_range_file] [pytorch_module_name] [pytorch_module_args]', sys.argv[0])
-        sys.exit(1)
+    parser = argparse.ArgumentParser(description='Generate C code from a Keras or PyTorch model')
+    parser.add_argument('weights_file', help='Keras .h5 model or PyTorch state dict')
+    parser.add_argument('quantization', nargs='?', default='float32', help='float32, int16 or int8')
+    parser.add_argument('activations_range_file', nargs='?', default='', help='Required for int16 or int8 quantization')
+    parser.add_argument('pytorch_module_name', nargs='?', default='')
+    parser.add_argument('pytorch_module_args', nargs='*', help='Arguments of the PyTorch module, after -- if one starts with -')
+    parser.add_argument('--conv-engine', default='direct', choices=KernelSelector.conv_engines,
+                        help='Preferred engine for convolutions')
+    parser.add_argument('--conv-scratch-size', type=int, default=8192,
+                        help='Maximum size in bytes of the im2col or Winograd buffer of a layer')
+    parser.add_argument('--fuse-separable-conv', action='store_true',
+                        help='Execute depthwise convolution → (BatchNorm) → pointwise convolution as a single layer')
+    parser.add_argument('--max-batch', type=int, default=1,
+                        help='Maximum number of samples processed by each layer at once by cnn_batch()')
+    parser.add_argument('--branch-parallelism', action='store_true',
+                        help='Run independent branches of the model concurrently when built with WITH_THREADS')
+    parser.add_argument('--pipeline-stages', type=int, default=1,
+                        help='Number of threads streaming the samples of cnn_batch() through stages of layers')
+    parser.add_argument('--stream-hop', type=int, default=0,
+                        help='Number of new input samples of each cnn_push() call, 0 to not generate cnn_push()')
+    parser.add_argument('--partial-update', action='store_true',
+                        help='Generate cnn_update() recomputing only the rows depending on a band of changed input rows')
+    parser.add_argument('--variable-length', action='store_true',
+                        help='Generate cnn_sequence() running 1D models on inputs shorter than the model input')
+    parser.add_argument('--split-layer', default=None,
+                        help="Last layer of the head package of a split model, 'auto' for the smallest output")
+    parser.add_argument('--no-activations-arena', dest='activations_arena', action='store_false',
+                        help='Allocate activations in unions of greedy pools rather than at offsets of a single arena')
+    # Options may also follow the positional arguments
+    args = parser.parse_intermixed_args()
 
     logging.basicConfig(format='%(asctime)s - %(name)s - %(levelname)s - %(message)s', level=logging.INFO)
 
-    return 0 if qualia_codegen(*sys.argv[1:]) else 1
+    return 0 if qualia_codegen(args.weights_file,
+                               args.quantization,
+                               args.activations_range_file,
+                               args.pytorch_module_name,
+                               *args.pytorch_module_args,
+                               conv_engine=args.conv_engine,
+                               conv_scratch_size=args.conv_scratch_size,
+                               fuse_separable_conv=args.fuse_separable_conv,
+                               max_batch=args.max_batch,
+                               branch_parallelism=args.branch_parallelism,
+                               pipeline_stages=args.pipeline_stages,
+                               stream_hop=args.stream_hop,
+                               partial_update=args.partial_update,
+                               variable_length=args.variable_length,
+                               split_layer=args.split_layer,
+                               activations_arena=args.activations_arena) else 1
 
 if __name__ == '__main__':
     sys.exit(main())
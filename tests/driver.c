@@ -0,0 +1,177 @@
+/* Test driver of a generated model: runs the entry point selected at compile time on a deterministic series of inputs and
+ * prints the output of each inference on its own line. Inputs only depend on the index of their values so that models built
+ * with other options or another input length see the same values.
+ *
+ * Entry point, cnn() by default: ENTRY_R, ENTRY_STEP (STEP_MACS per step), ENTRY_BATCH, ENTRY_PUSH, ENTRY_UPDATE,
+ * ENTRY_SEQUENCE, ENTRY_HEAD (frames of the head outputs on stdout) or ENTRY_TAIL (frames read from stdin). Series of inputs, independent samples by default: WINDOW_HOP slides a window of MODEL_INPUT_DIM_0 rows by
+ * WINDOW_HOP rows from a window of zeros, FRAMES changes a range of rows of the previous frame, SEQUENCE_SAMPLES only sets
+ * the first rows of each input. */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "model.h"
+#if defined(ENTRY_HEAD) || defined(ENTRY_TAIL)
+#include "link.h"
+#endif
+
+#ifdef SEQUENCE_SAMPLES
+#define ROWS SEQUENCE_SAMPLES
+#else
+#define ROWS MODEL_INPUT_DIM_0
+#endif
+#define ROW_DIMS (MODEL_INPUT_DIMS / MODEL_INPUT_DIM_0)
+
+static uint32_t hash(uint32_t i) {
+  i ^= i >> 16;
+  i *= 0x7feb352dU;
+  i ^= i >> 15;
+  i *= 0x846ca68bU;
+  i ^= i >> 16;
+  return i;
+}
+
+// Value of index i in [-2, 2), converted to the number type of the model input
+static MODEL_INPUT_NUMBER_T value(uint32_t i) {
+  float v = (float)(hash(i) >> 8) / (float)(1 << 24) * 4.0f - 2.0f;
+
+  if ((MODEL_INPUT_NUMBER_T)0.5 == 0) {
+    return clamp_to(MODEL_INPUT_NUMBER_T, (long)floorf(v * (1 << MODEL_INPUT_SCALE_FACTOR)));
+  }
+  return v;
+}
+
+// Input of inference s, returns the rows [*start, *end) that differ from the previous input
+static void next_input(unsigned int s, input_t input, unsigned int *start, unsigned int *end) {
+  MODEL_INPUT_NUMBER_T *flat = (MODEL_INPUT_NUMBER_T *)input;
+  unsigned int r, i;
+
+#if defined(WINDOW_HOP)
+  // Window of the rows [(s + 1) * WINDOW_HOP - MODEL_INPUT_DIM_0, (s + 1) * WINDOW_HOP) of a stream starting after zeros
+  for (r = 0; r < MODEL_INPUT_DIM_0; r++) {
+    long row = (long)(s + 1) * WINDOW_HOP - MODEL_INPUT_DIM_0 + r;
+
+    for (i = 0; i < ROW_DIMS; i++) {
+      flat[r * ROW_DIMS + i] = row < 0 ? 0 : value((uint32_t)row * ROW_DIMS + i);
+    }
+  }
+  *start = 0;
+  *end = MODEL_INPUT_DIM_0;
+#elif defined(FRAMES)
+  // First frame is set entirely, each next one changes a possibly empty range of rows
+  *start = s == 0 ? 0 : hash(2 * s) % (MODEL_INPUT_DIM_0 + 1);
+  *end = s == 0 ? MODEL_INPUT_DIM_0 : *start + hash(2 * s + 1) % (MODEL_INPUT_DIM_0 + 1 - *start);
+  for (r = *start; r < *end; r++) {
+    for (i = 0; i < ROW_DIMS; i++) {
+      flat[r * ROW_DIMS + i] = value(s * 100003U + r * ROW_DIMS + i);
+    }
+  }
+#else
+  // Rows after ROWS are not part of the sequence, set to a value that would change the output if they were read
+  for (r = 0; r < MODEL_INPUT_DIM_0; r++) {
+    for (i = 0; i < ROW_DIMS; i++) {
+      flat[r * ROW_DIMS + i] = r < ROWS ? value(s * 100003U + r * ROW_DIMS + i) : (MODEL_INPUT_NUMBER_T)7;
+    }
+  }
+  *start = 0;
+  *end = MODEL_INPUT_DIM_0;
+#endif
+}
+
+static void print_output(const output_t output, size_t n) {
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    printf("%.9g ", (double)((const MODEL_OUTPUT_NUMBER_T *)output)[i]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int n = argc > 1 ? (unsigned int)atoi(argv[1]) : 1;
+  size_t outputs = sizeof(output_t) / sizeof(MODEL_OUTPUT_NUMBER_T);
+  unsigned int s, start, end;
+  static input_t input;
+  static output_t output;
+#if defined(ENTRY_R)
+  // Inferences alternate between two contexts
+  cnn_ctx_t *ctx[2] = { calloc(1, cnn_ctx_size()), calloc(1, cnn_ctx_size()) };
+#elif defined(ENTRY_BATCH)
+  input_t *inputs = calloc(n, sizeof(input_t));
+  output_t *batch_outputs = calloc(n, sizeof(output_t));
+#elif defined(ENTRY_HEAD) || defined(ENTRY_TAIL)
+  static unsigned char frame[LINK_FRAME_SIZE];
+  long size;
+#endif
+
+#ifdef ENTRY_TAIL
+  (void)s;
+  (void)start;
+  (void)end;
+  while ((size = link_receive(0, frame)) > 0) {
+    if (link_decode(frame, (size_t)size, (LINK_NUMBER_T *)input) < 0) {
+      return 1;
+    }
+    cnn(input, output);
+    print_output(output, outputs);
+  }
+  return size < 0;
+#else
+  for (s = 0; s < n; s++) {
+    next_input(s, input, &start, &end);
+
+#if defined(ENTRY_R)
+    cnn_r(ctx[s % 2], input, output);
+#elif defined(ENTRY_STEP)
+    cnn_begin(input, output);
+    while (!cnn_step(STEP_MACS)) {
+    }
+    if (!cnn_done()) {
+      return 1;
+    }
+#elif defined(ENTRY_BATCH)
+    memcpy(inputs[s], input, sizeof(input_t));
+    continue;
+#elif defined(ENTRY_PUSH)
+    cnn_push((const sample_t *)input[MODEL_INPUT_DIM_0 - MODEL_STREAM_HOP], output);
+#elif defined(ENTRY_UPDATE)
+    if (s == 0) {
+      cnn(input, output);
+    } else {
+      cnn_update(input, (unsigned short)start, (unsigned short)end, output);
+    }
+#elif defined(ENTRY_SEQUENCE)
+    // Only the output positions of the sequence are valid, unless they are summed by the last layer
+    if (outputs > MODEL_OUTPUT_SAMPLES) {
+      print_output(output, (size_t)cnn_sequence(input, SEQUENCE_SAMPLES, output) * MODEL_OUTPUT_SAMPLES);
+    } else {
+      cnn_sequence(input, SEQUENCE_SAMPLES, output);
+      print_output(output, outputs);
+    }
+    continue;
+#elif defined(ENTRY_HEAD)
+    cnn(input, output);
+    size = (long)link_encode((const LINK_NUMBER_T *)output, frame, 1);
+    if (link_send(1, frame, (size_t)size) < 0) {
+      return 1;
+    }
+    continue;
+#else
+    cnn(input, output);
+#endif
+    (void)start;
+    (void)end;
+    print_output(output, outputs);
+  }
+
+#ifdef ENTRY_BATCH
+  cnn_batch((const input_t *)inputs, batch_outputs, n);
+  for (s = 0; s < n; s++) {
+    print_output(batch_outputs[s], outputs);
+  }
+#endif
+  return 0;
+#endif
+}
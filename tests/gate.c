@@ -0,0 +1,40 @@
+/* Test driver of the change gate of neuralNetworkInfer(): sets the gate threshold to argv[1], then runs one inference per
+ * following argument on a fixed input shifted by this value and prints the result, the counters of the gate and the result
+ * of the same input computed without the gate on its own line. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "NeuralNetwork.h"
+
+int main(int argc, char *argv[]) {
+  static float input[MODEL_INPUT_DIMS];
+  static output_t output;
+  struct NNResult result;
+  struct NNGateStats stats;
+  unsigned int label;
+  int a;
+  size_t i;
+
+  neuralNetworkSetGate(strtof(argv[1], NULL));
+
+  for (a = 2; a < argc; a++) {
+    for (i = 0; i < MODEL_INPUT_DIMS; i++) {
+      input[i] = sinf((float)i * 0.7f) + strtof(argv[a], NULL);
+    }
+
+    result = neuralNetworkInfer(input);
+    stats = neuralNetworkGateStats();
+
+    neuralNetworkRun(input, output);
+    for (i = 1, label = 0; i < MODEL_OUTPUT_SAMPLES; i++) {
+      if (output[label] < output[i]) {
+        label = (unsigned int)i;
+      }
+    }
+
+    printf("%u %u %.9g %lu %lu %u %.9g\n", result.inference_count, result.label, (double)result.dist, stats.hits,
+           stats.misses, label, (double)output[label]);
+  }
+  return 0;
+}
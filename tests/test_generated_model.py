@@ -0,0 +1,759 @@
+"""Compare the outputs of generated models compiled with gcc.
+
+The generated code is compared against a NumPy reference of the layers, and code generation options against the code
+generated without them on the same inputs. Models are built directly as a :class:`ModelGraph` with fixed quantization
+parameters so that neither Keras nor PyTorch is needed.
+"""
+
+from __future__ import annotations
+
+import logging
+import math
+import platform
+import shutil
+import subprocess
+import sys
+from pathlib import Path
+from typing import TYPE_CHECKING, Any, Callable
+
+import numpy as np
+import pytest
+
+from qualia_codegen_core import Converter
+from qualia_codegen_core.Allocator import Allocator
+from qualia_codegen_core.graph import ModelGraph, Quantization
+from qualia_codegen_core.graph.layers import (
+    TAddLayer,
+    TBatchNormalization1DLayer,
+    TConcatenateLayer,
+    TConv1DLayer,
+    TConv2DLayer,
+    TDenseLayer,
+    TFlattenLayer,
+    TInputLayer,
+    TMaxPooling1DLayer,
+    TMaxPooling2DLayer,
+    TSliceLayer,
+    TSumLayer,
+)
+from qualia_codegen_core.graph.layers.TActivationLayer import TActivation
+from qualia_codegen_core.graph.RoundMode import RoundMode
+from qualia_codegen_core.KernelSelector import KernelSelector
+from qualia_codegen_core.typing import DTypes, Shape, Shapes
+
+if TYPE_CHECKING:
+    from qualia_codegen_core.graph.LayerNode import LayerNode
+    from qualia_codegen_core.graph.layers import TBaseLayer
+
+pytestmark = pytest.mark.skipif(shutil.which('gcc') is None or sys.platform == 'win32', reason='Requires gcc on a POSIX host')
+
+DRIVER = Path(__file__).parent / 'driver.c'
+GATE_DRIVER = Path(__file__).parent / 'gate.c'
+LIBQUALIA_NEURALNETWORK = Path(__file__).parent.parent / 'src' / 'libqualia-neuralnetwork'
+# Not a multiple of the mini-batch size so that cnn_batch() also computes an incomplete mini-batch
+SAMPLES = 7
+
+QUANTIZATIONS = {
+    'float32': Quantization(float, 32, 32, 0, None, 0, RoundMode.NONE, RoundMode.NONE),
+    'int16': Quantization(int, 16, 32, 9, None, 9, RoundMode.FLOOR, RoundMode.FLOOR),
+    'int8': Quantization(int, 8, 16, 5, None, 4, RoundMode.NEAREST, RoundMode.NEAREST),
+}
+
+NDArray = np.ndarray[Any, np.dtype[Any]]
+
+
+class ModelBuilder:
+    """Build a :class:`ModelGraph` layer by layer with random weights, layers are named after their type and index."""
+
+    def __init__(self, input_shape: tuple[int, ...], seed: int) -> None:
+        self.modelgraph = ModelGraph()
+        self.rng = np.random.default_rng(seed)
+        self.input = TInputLayer(self.shapes(input_shape), self.shapes(input_shape), DTypes((np.float32,)), 'input')
+        self.modelgraph.add_layer(self.input)
+
+    @staticmethod
+    def shapes(shape: tuple[int, ...]) -> Shapes:
+        return Shapes((Shape((1, *shape)),))
+
+    def name(self, prefix: str) -> str:
+        return f'{prefix}_{len(self.modelgraph.nodes)}'
+
+    def weights(self, *shape: int, scale: float) -> NDArray:
+        return (self.rng.standard_normal(shape) * scale).astype(np.float32)
+
+    def add(self, layer: TBaseLayer, *inputs: TBaseLayer) -> TBaseLayer:
+        self.modelgraph.add_layer(layer, inlayers=list(inputs))
+        return layer
+
+    def conv1d(self,  # noqa: PLR0913, PLR0917 One parameter per layer attribute
+               x: TBaseLayer,
+               filters: int,
+               kernel_size: int,
+               stride: int = 1,
+               padding: tuple[int, int] = (0, 0),
+               groups: int = 1,
+               activation: TActivation = TActivation.LINEAR) -> TBaseLayer:
+        samples, channels = x.output_shape[0][1:]
+        output_samples = (samples + sum(padding) - kernel_size) // stride + 1
+        return self.add(TConv1DLayer(self.shapes((samples, channels)), self.shapes((output_samples, filters)),
+                                     DTypes((np.float32,)), self.name('conv1d'), activation,
+                                     self.weights(filters, kernel_size, channels // groups,
+                                                  scale=1 / math.sqrt(kernel_size * channels / groups)),
+                                     (kernel_size,), (stride,), filters, True, self.weights(filters, scale=0.1), groups,  # noqa: FBT003
+                                     padding), x)
+
+    def conv2d(self,  # noqa: PLR0913, PLR0917 One parameter per layer attribute
+               x: TBaseLayer,
+               filters: int,
+               kernel_size: tuple[int, int],
+               strides: tuple[int, int] = (1, 1),
+               padding: tuple[tuple[int, int], tuple[int, int]] = ((0, 0), (0, 0)),
+               groups: int = 1,
+               activation: TActivation = TActivation.LINEAR) -> TBaseLayer:
+        height, width, channels = x.output_shape[0][1:]
+        output_shape = ((height + sum(padding[0]) - kernel_size[0]) // strides[0] + 1,
+                        (width + sum(padding[1]) - kernel_size[1]) // strides[1] + 1,
+                        filters)
+        return self.add(TConv2DLayer(self.shapes((height, width, channels)), self.shapes(output_shape),
+                                     DTypes((np.float32,)), self.name('conv2d'), activation,
+                                     self.weights(filters, *kernel_size, channels // groups,
+                                                  scale=1 / math.sqrt(math.prod(kernel_size) * channels / groups)),
+                                     kernel_size, strides, filters, True, self.weights(filters, scale=0.1), groups,  # noqa: FBT003
+                                     padding), x)
+
+    def maxpool1d(self, x: TBaseLayer, pool_size: int) -> TBaseLayer:
+        samples, channels = x.output_shape[0][1:]
+        return self.add(TMaxPooling1DLayer(self.shapes((samples, channels)), self.shapes((samples // pool_size, channels)),
+                                           DTypes((np.float32,)), self.name('maxpool1d'), TActivation.LINEAR, (pool_size,),
+                                           (pool_size,)), x)
+
+    def maxpool2d(self, x: TBaseLayer, pool_size: int) -> TBaseLayer:
+        height, width, channels = x.output_shape[0][1:]
+        return self.add(TMaxPooling2DLayer(self.shapes((height, width, channels)),
+                                           self.shapes((height // pool_size, width // pool_size, channels)),
+                                           DTypes((np.float32,)), self.name('maxpool2d'), TActivation.LINEAR,
+                                           (pool_size, pool_size), (pool_size, pool_size)), x)
+
+    def batchnorm1d(self, x: TBaseLayer, activation: TActivation = TActivation.LINEAR) -> TBaseLayer:
+        shape = x.output_shape[0][1:]
+        channels = shape[-1]
+        return self.add(TBatchNormalization1DLayer(self.shapes(shape), self.shapes(shape), DTypes((np.float32,)),
+                                                   self.name('batchnorm1d'), activation, self.weights(channels, scale=0.1),
+                                                   np.abs(self.weights(channels, scale=0.5)) + 0.5,
+                                                   1 + self.weights(channels, scale=0.1), self.weights(channels, scale=0.1),
+                                                   np.float32(1e-5)), x)
+
+    def add_layers(self, *xs: TBaseLayer, activation: TActivation = TActivation.LINEAR) -> TBaseLayer:
+        shape = xs[0].output_shape[0][1:]
+        return self.add(TAddLayer(Shapes(tuple(x.output_shape[0] for x in xs)), self.shapes(shape), DTypes((np.float32,)),
+                                  self.name('add'), activation), *xs)
+
+    def concatenate(self, *xs: TBaseLayer) -> TBaseLayer:
+        shape = (sum(x.output_shape[0][1] for x in xs), *xs[0].output_shape[0][2:])
+        return self.add(TConcatenateLayer(Shapes(tuple(x.output_shape[0] for x in xs)), self.shapes(shape),
+                                          DTypes((np.float32,)), self.name('concatenate')), *xs)
+
+    def slice_samples(self, x: TBaseLayer, start: int, stop: int) -> TBaseLayer:
+        shape = x.output_shape[0][1:]
+        return self.add(TSliceLayer(self.shapes(shape), self.shapes((stop - start, *shape[1:])), DTypes((np.float32,)),
+                                    self.name('slice'), (slice(None), slice(start, stop), slice(None))), x)
+
+    def flatten(self, x: TBaseLayer) -> TBaseLayer:
+        shape = x.output_shape[0][1:]
+        return self.add(TFlattenLayer(self.shapes(shape), self.shapes((math.prod(shape),)), DTypes((np.float32,)),
+                                      self.name('flatten')), x)
+
+    def sum(self, x: TBaseLayer) -> TBaseLayer:
+        shape = x.output_shape[0][1:]
+        return self.add(TSumLayer(self.shapes(shape), self.shapes((shape[-1],)), DTypes((np.float32,)), self.name('sum'),
+                                  (-1,)), x)
+
+    def dense(self, x: TBaseLayer, units: int) -> TBaseLayer:
+        (inputs,) = x.output_shape[0][1:]
+        return self.add(TDenseLayer(self.shapes((inputs,)), self.shapes((units,)), DTypes((np.float32,)), self.name('dense'),
+                                    TActivation.LINEAR, self.weights(units, inputs, scale=1 / math.sqrt(inputs)), units, True,  # noqa: FBT003
+                                    self.weights(units, scale=0.1)), x)
+
+    def quantize(self, quantization: str) -> ModelGraph:
+        for node in self.modelgraph.nodes:
+            node.q = QUANTIZATIONS[quantization]
+        return self.modelgraph
+
+
+def conv1d_model(quantization: str, samples: int = 40) -> ModelGraph:
+    """Conv1D model with valid, padded and grouped convolutions, summed over positions."""
+    b = ModelBuilder((samples, 4), seed=1)
+    x = b.conv1d(b.input, 8, 3, activation=TActivation.RELU)
+    x = b.maxpool1d(x, 2)
+    x = b.conv1d(x, 8, 3, groups=8, activation=TActivation.RELU)
+    x = b.conv1d(x, 12, 3, padding=(1, 1), activation=TActivation.RELU)
+    x = b.conv1d(x, 6, 1)
+    b.sum(x)
+    return b.quantize(quantization)
+
+
+def conv2d_model(quantization: str) -> ModelGraph:
+    """Conv2D model with padded, grouped and valid convolutions followed by a fully-connected layer."""
+    b = ModelBuilder((12, 10, 3), seed=2)
+    x = b.conv2d(b.input, 8, (3, 3), padding=((1, 1), (1, 1)), activation=TActivation.RELU)
+    x = b.maxpool2d(x, 2)
+    x = b.conv2d(x, 8, (3, 3), padding=((1, 1), (1, 1)), groups=8, activation=TActivation.RELU)
+    x = b.conv2d(x, 6, (3, 3))
+    x = b.flatten(x)
+    b.dense(x, 4)
+    return b.quantize(quantization)
+
+
+def separable_conv1d_model(quantization: str) -> ModelGraph:
+    """Conv1D model with depthwise → BatchNorm → pointwise and depthwise with a channel multiplier → pointwise chains."""
+    b = ModelBuilder((24, 6), seed=7)
+    x = b.conv1d(b.input, 8, 3, activation=TActivation.RELU)
+    x = b.conv1d(x, 8, 3, padding=(1, 1), groups=8, activation=TActivation.RELU)
+    x = b.batchnorm1d(x, activation=TActivation.RELU)
+    x = b.conv1d(x, 10, 1, activation=TActivation.RELU)
+    x = b.maxpool1d(x, 2)
+    x = b.conv1d(x, 20, 3, groups=10, activation=TActivation.RELU)
+    x = b.conv1d(x, 6, 1)
+    b.sum(x)
+    return b.quantize(quantization)
+
+
+def separable_conv2d_model(quantization: str) -> ModelGraph:
+    """Conv2D model with a padded depthwise → pointwise chain followed by a fully-connected layer."""
+    b = ModelBuilder((9, 8, 3), seed=8)
+    x = b.conv2d(b.input, 8, (3, 3), padding=((1, 1), (1, 1)), activation=TActivation.RELU)
+    x = b.conv2d(x, 8, (3, 3), padding=((1, 1), (1, 1)), groups=8, activation=TActivation.RELU)
+    x = b.conv2d(x, 12, (1, 1), activation=TActivation.RELU)
+    x = b.maxpool2d(x, 2)
+    x = b.flatten(x)
+    b.dense(x, 4)
+    return b.quantize(quantization)
+
+
+
+def dense_model(quantization: str) -> ModelGraph:
+    """Fully-connected layers with units not multiples of the panel size."""
+    b = ModelBuilder((6, 10), seed=9)
+    x = b.flatten(b.input)
+    x = b.dense(x, 11)
+    x = b.dense(x, 6)
+    b.dense(x, 3)
+    return b.quantize(quantization)
+
+def branch_model(quantization: str) -> ModelGraph:
+    """Model with a Slice, two pairs of independent branches joined by a Concatenate and an Add, and BatchNorm."""
+    b = ModelBuilder((16, 4), seed=3)
+    x = b.conv1d(b.input, 8, 3, padding=(1, 1))
+    x = b.batchnorm1d(x, activation=TActivation.RELU)
+    x = b.slice_samples(x, 4, 12)
+    y1 = b.conv1d(x, 8, 3, padding=(1, 1), activation=TActivation.RELU)
+    y2 = b.conv1d(x, 8, 1, activation=TActivation.RELU)
+    x = b.concatenate(y1, y2)
+    z1 = b.conv1d(x, 8, 3, stride=2)
+    z2 = b.conv1d(x, 8, 3, stride=2, activation=TActivation.RELU)
+    x = b.add_layers(z1, z2, activation=TActivation.RELU)
+    x = b.flatten(x)
+    b.dense(x, 4)
+    return b.quantize(quantization)
+
+
+def input_values(s: int, shape: tuple[int, ...]) -> NDArray:
+    """Input of inference s given by the test driver."""
+    i = np.arange(math.prod(shape), dtype=np.uint32) + np.uint32(s * 100003)
+    i ^= i >> 16
+    i *= np.uint32(0x7feb352d)
+    i ^= i >> 15
+    i *= np.uint32(0x846ca68b)
+    i ^= i >> 16
+    return np.asarray((i >> 8).astype(np.float32) / np.float32(1 << 24) * np.float32(4) - np.float32(2)).reshape(shape)
+
+
+def activate(x: NDArray, activation: TActivation) -> NDArray:
+    if activation == TActivation.RELU:
+        return np.maximum(x, 0)
+    assert activation == TActivation.LINEAR
+    return x
+
+
+def reference_conv(x: NDArray, layer: TConv1DLayer | TConv2DLayer) -> NDArray:
+    """Convolution of channels-last x with a kernel of shape ``[filters][*kernel_size][channels / groups]``."""
+    kernel = np.asarray(layer.kernel, dtype=np.float64)
+    padding = [layer.padding] if isinstance(layer, TConv1DLayer) else list(layer.padding)
+    x = np.pad(x, [*padding, (0, 0)])
+    channels_per_group = kernel.shape[-1]
+    filters_per_group = layer.filters // layer.groups
+
+    output = np.zeros(layer.output_shape[0][1:])
+    for position in np.ndindex(*output.shape[:-1]):
+        window = x[tuple(slice(p * s, p * s + k) for p, s, k in zip(position, layer.strides, layer.kernel_size))]
+        for g in range(layer.groups):
+            filters = slice(g * filters_per_group, (g + 1) * filters_per_group)
+            output[position][filters] = np.tensordot(kernel[filters],
+                                                     window[..., g * channels_per_group:(g + 1) * channels_per_group],
+                                                     axes=kernel.ndim - 1)
+    if layer.use_bias:
+        output += layer.bias
+    return activate(output, layer.activation)
+
+
+def reference_maxpool(x: NDArray, layer: TMaxPooling1DLayer | TMaxPooling2DLayer) -> NDArray:
+    output = np.zeros(layer.output_shape[0][1:])
+    for position in np.ndindex(*output.shape[:-1]):
+        window = x[tuple(slice(p * s, p * s + k) for p, s, k in zip(position, layer.strides, layer.pool_size))]
+        output[position] = window.max(axis=tuple(range(window.ndim - 1)))
+    return activate(output, layer.activation)
+
+
+def reference_layer(x: NDArray, layer: TBaseLayer) -> NDArray:
+    if isinstance(layer, TBatchNormalization1DLayer):
+        output = (x - layer.mean) / np.sqrt(layer.variance + layer.epsilon) * layer.gamma + layer.beta
+        return activate(output, layer.activation)
+    if isinstance(layer, (TConv1DLayer, TConv2DLayer)):
+        return reference_conv(x, layer)
+    if isinstance(layer, (TMaxPooling1DLayer, TMaxPooling2DLayer)):
+        return reference_maxpool(x, layer)
+    if isinstance(layer, TDenseLayer):
+        output = np.asarray(layer.kernel, dtype=np.float64) @ x + (layer.bias if layer.use_bias else 0)
+        return activate(output, layer.activation)
+    if isinstance(layer, TFlattenLayer):
+        return x.reshape(-1)
+    if isinstance(layer, TSumLayer):
+        return np.asarray(x.sum(axis=tuple(range(x.ndim - 1))))
+    msg = f'No reference for {type(layer).__name__}'
+    raise NotImplementedError(msg)
+
+
+def reference_outputs(modelgraph: ModelGraph) -> NDArray:
+    """Compute in float64 with NumPy the outputs of a sequential float model for the inputs of the test driver."""
+    outputs = []
+    for s in range(SAMPLES):
+        x = input_values(s, modelgraph.nodes[0].layer.output_shape[0][1:]).astype(np.float64)
+        for node in modelgraph.nodes[1:]:
+            x = reference_layer(x, node.layer)
+        outputs.append(x.reshape(-1))
+    return np.array(outputs)
+
+
+def generate(modelgraph: ModelGraph, output_path: Path, **converter_options: Any) -> Path:  # noqa: ANN401 Converter keyword arguments of any type
+    assert Converter(output_path=output_path, **converter_options).convert_model(modelgraph)
+    return output_path
+
+
+def compile_driver(package: Path, *defines: str, cflags: tuple[str, ...] = ()) -> Path:
+    if 'WITH_THREADS' in defines:
+        # Several threads even on a single core host
+        defines = (*defines, 'PARALLEL_THREADS=3')
+        cflags = (*cflags, '-pthread')
+    binary = package / 'driver'
+    subprocess.run(['gcc', '-std=gnu11', '-O2', '-Wall',  # noqa: S603, S607 Trusted compiler command
+                    '-include', str(package / 'include' / 'defines.h'),
+                    *(f'-D{define}' for define in defines),
+                    *cflags,
+                    '-I', str(package), '-I', str(package / 'include'),
+                    str(DRIVER), str(package / 'model.c'), '-lm', '-o', str(binary)],
+                   check=True)
+    return binary
+
+
+def parse_outputs(stdout: bytes) -> NDArray:
+    return np.array([[float(v) for v in line.split()] for line in stdout.decode().splitlines()])
+
+
+def run_driver(binary: Path, stdin: bytes | None = None) -> bytes:
+    return subprocess.run([str(binary), str(SAMPLES)], input=stdin, capture_output=True, check=True).stdout  # noqa: S603 Compiled test driver
+
+
+def infer(package: Path, *defines: str, cflags: tuple[str, ...] = ()) -> NDArray:
+    return parse_outputs(run_driver(compile_driver(package, *defines, cflags=cflags)))
+
+
+def assert_same_outputs(actual: NDArray, expected: NDArray, quantization: str) -> None:
+    assert actual.shape == expected.shape
+    if quantization == 'float32':
+        np.testing.assert_allclose(actual, expected, rtol=1e-4, atol=1e-5)
+    else:
+        np.testing.assert_array_equal(actual, expected)
+
+
+def assert_reference_outputs(package: Path, modelgraph: ModelGraph) -> None:
+    np.testing.assert_allclose(infer(package), reference_outputs(modelgraph), rtol=1e-4, atol=1e-4)
+
+
+def generated_source(package: Path) -> str:
+    return '\n'.join(path.read_text() for path in package.rglob('*.[ch]'))
+
+
+@pytest.fixture(params=QUANTIZATIONS.keys())
+def quantization(request: pytest.FixtureRequest) -> str:
+    return str(request.param)
+
+
+@pytest.fixture(params=['conv1d', 'conv2d'])
+def model(request: pytest.FixtureRequest) -> Callable[[str], ModelGraph]:
+    return conv1d_model if request.param == 'conv1d' else conv2d_model
+
+
+@pytest.mark.parametrize('conv_engine', ['direct', 'im2col', 'winograd'])
+def test_reference(tmp_path: Path, model: Callable[[str], ModelGraph], conv_engine: str) -> None:
+    # Weights may be transformed by the Converter, the reference uses a separate copy of the model
+    package = generate(model('float32'), tmp_path / 'model', conv_engine=conv_engine)
+    assert_reference_outputs(package, model('float32'))
+
+
+@pytest.mark.parametrize(('conv_engine', 'marker'), [('im2col', 'GEMM_MR'), ('winograd', 'WINOGRAD_M')])
+def test_conv_engine(tmp_path: Path,
+                     model: Callable[[str], ModelGraph],
+                     quantization: str,
+                     conv_engine: str,
+                     marker: str) -> None:
+    reference = generate(model(quantization), tmp_path / 'reference')
+    package = generate(model(quantization), tmp_path / 'model', conv_engine=conv_engine)
+    # Winograd transforms would overflow the 16-bit accumulator of int8 layers, which keep the direct engine
+    assert (marker in generated_source(package)) == (conv_engine != 'winograd' or quantization != 'int8')
+    assert_same_outputs(infer(package), infer(reference), quantization)
+
+
+@pytest.mark.parametrize(('filters', 'kernel_size', 'strides', 'padding', 'groups'), [
+    (5, (3, 3), (1, 1), ((0, 0), (0, 0)), 1),  # Filters and output width not multiples of the tile
+    (6, (3, 2), (2, 1), ((1, 0), (2, 1)), 1),  # Non-square kernel, stride and asymmetric padding
+    (6, (1, 1), (1, 1), ((0, 0), (0, 0)), 2),  # Fewer filters per group than the tile
+    (4, (5, 5), (1, 1), ((2, 2), (4, 0)), 1),  # Border wider than the kernel on one side
+    (4, (3, 3), (2, 2), ((1, 1), (1, 1)), 1),  # Strided border and interior
+])
+def test_conv2d_reference(tmp_path: Path,  # noqa: PLR0913, PLR0917
+                          filters: int,
+                          kernel_size: tuple[int, int],
+                          strides: tuple[int, int],
+                          padding: tuple[tuple[int, int], tuple[int, int]],
+                          groups: int) -> None:
+    def conv2d_layer() -> ModelGraph:
+        b = ModelBuilder((7, 9, 4), seed=4)
+        b.conv2d(b.input, filters, kernel_size, strides, padding, groups, TActivation.RELU)
+        return b.quantize('float32')
+
+    assert_reference_outputs(generate(conv2d_layer(), tmp_path / 'model'), conv2d_layer())
+
+
+@pytest.mark.parametrize(('filters', 'kernel_size', 'stride', 'padding', 'groups'), [
+    (5, 5, 2, (0, 0), 1),  # Unrolled taps with a stride, filters and positions not multiples of the tile
+    (6, 4, 1, (2, 1), 1),  # Tap loop and asymmetric padding
+    (6, 3, 1, (1, 1), 2),  # Fewer filters per group than the tile
+    (4, 19, 1, (3, 3), 1),  # No interior, every position reads padding
+    (4, 5, 3, (2, 0), 1),  # Strided border on the left only
+])
+def test_conv1d_reference(tmp_path: Path,  # noqa: PLR0913, PLR0917
+                          filters: int,
+                          kernel_size: int,
+                          stride: int,
+                          padding: tuple[int, int],
+                          groups: int) -> None:
+    def conv1d_layer() -> ModelGraph:
+        b = ModelBuilder((17, 4), seed=5)
+        b.conv1d(b.input, filters, kernel_size, stride, padding, groups, TActivation.RELU)
+        return b.quantize('float32')
+
+    assert_reference_outputs(generate(conv1d_layer(), tmp_path / 'model'), conv1d_layer())
+
+
+@pytest.mark.parametrize('dims', [1, 2])
+def test_depthwise_reference(tmp_path: Path, dims: int) -> None:
+    # Channel multiplier of 2 and more channels than the tile
+    def depthwise_layer() -> ModelGraph:
+        if dims == 1:
+            b = ModelBuilder((11, 20), seed=6)
+            b.conv1d(b.input, 40, 3, padding=(2, 0), groups=20)
+        else:
+            b = ModelBuilder((5, 6, 20), seed=6)
+            b.conv2d(b.input, 40, (3, 3), padding=((1, 1), (0, 2)), groups=20)
+        return b.quantize('float32')
+
+    package = generate(depthwise_layer(), tmp_path / 'model')
+    assert 'DEPTHWISE_TILE_C' in generated_source(package)
+    assert_reference_outputs(package, depthwise_layer())
+
+
+def test_depthwise(tmp_path: Path,
+                   model: Callable[[str], ModelGraph],
+                   quantization: str,
+                   monkeypatch: pytest.MonkeyPatch) -> None:
+    package = generate(model(quantization), tmp_path / 'model')
+    assert 'DEPTHWISE_TILE_C' in generated_source(package)
+
+    # Depthwise convolutions computed as grouped convolutions by the direct engine
+    monkeypatch.setattr(KernelSelector, 'conv_engine', lambda _self, _node, partial=False: 'direct')  # noqa: ARG005
+    reference = generate(model(quantization), tmp_path / 'reference')
+    assert 'DEPTHWISE_TILE_C' not in generated_source(reference)
+
+    assert_same_outputs(infer(package), infer(reference), quantization)
+
+
+@pytest.fixture(params=['separable_conv1d', 'separable_conv2d'])
+def separable_model(request: pytest.FixtureRequest) -> Callable[[str], ModelGraph]:
+    return separable_conv1d_model if request.param == 'separable_conv1d' else separable_conv2d_model
+
+
+def test_separable_conv_reference(tmp_path: Path, separable_model: Callable[[str], ModelGraph]) -> None:
+    package = generate(separable_model('float32'), tmp_path / 'model', fuse_separable_conv=True)
+    assert_reference_outputs(package, separable_model('float32'))
+
+
+def test_fuse_separable_conv(tmp_path: Path, separable_model: Callable[[str], ModelGraph], quantization: str) -> None:
+    reference = generate(separable_model(quantization), tmp_path / 'reference')
+    assert 'separableconv' not in generated_source(reference)
+    package = generate(separable_model(quantization), tmp_path / 'model', fuse_separable_conv=True)
+    assert 'separableconv' in generated_source(package)
+    assert_same_outputs(infer(package), infer(reference), quantization)
+
+
+@pytest.mark.parametrize(('input_block_size', 'blocked'), [(8192, False), (16, True)])
+def test_dense_reference(tmp_path: Path, input_block_size: int, *, blocked: bool) -> None:
+    converter = Converter(output_path=tmp_path / 'model')
+    # Blocks smaller than the inputs to keep the accumulators of all units across blocks
+    converter.kernelselector.fc_input_block_size = input_block_size
+    assert converter.convert_model(dense_model('float32'))
+    assert ('FC_INPUT_BLOCK 4\n' in generated_source(tmp_path / 'model')) == blocked
+    assert_reference_outputs(tmp_path / 'model', dense_model('float32'))
+
+
+def test_dense_input_block(tmp_path: Path, quantization: str) -> None:
+    reference = generate(dense_model(quantization), tmp_path / 'reference')
+    converter = Converter(output_path=tmp_path / 'model')
+    converter.kernelselector.fc_input_block_size = 16
+    assert converter.convert_model(dense_model(quantization))
+    assert_same_outputs(infer(tmp_path / 'model'), infer(reference), quantization)
+
+
+@pytest.mark.skipif(platform.machine() not in {'x86_64', 'AMD64'}, reason='x86-64 only')
+@pytest.mark.parametrize(('modelgraph', 'fuse_separable_conv'), [
+    (conv1d_model, False),
+    (conv2d_model, False),
+    (separable_conv1d_model, True),
+    (separable_conv2d_model, True),
+])
+def test_x86_simd(tmp_path: Path,
+                  modelgraph: Callable[[str], ModelGraph],
+                  quantization: str,
+                  fuse_separable_conv: bool) -> None:  # noqa: FBT001
+    package = generate(modelgraph(quantization), tmp_path / 'model', fuse_separable_conv=fuse_separable_conv)
+    # The clone picked for the CPU running the test must give the outputs of the portable build
+    assert_same_outputs(infer(package, 'WITH_X86_SIMD', cflags=('-mprefer-vector-width=256',)),
+                        infer(package),
+                        quantization)
+
+
+@pytest.mark.parametrize('modelgraph', [conv1d_model, conv2d_model, dense_model])
+@pytest.mark.parametrize('max_batch', [1, 3])
+def test_cnn_batch(tmp_path: Path, modelgraph: Callable[[str], ModelGraph], quantization: str, max_batch: int) -> None:
+    reference = generate(modelgraph(quantization), tmp_path / 'reference')
+    package = generate(modelgraph(quantization), tmp_path / 'model', max_batch=max_batch)
+    assert_same_outputs(infer(package, 'ENTRY_BATCH'), infer(reference), quantization)
+
+
+def test_cnn_r(tmp_path: Path, model: Callable[[str], ModelGraph], quantization: str) -> None:
+    package = generate(model(quantization), tmp_path / 'model')
+    assert_same_outputs(infer(package, 'ENTRY_R'), infer(package), quantization)
+
+
+@pytest.mark.parametrize('modelgraph', [conv1d_model, conv2d_model, dense_model])
+def test_parallel_layers(tmp_path: Path, modelgraph: Callable[[str], ModelGraph], quantization: str) -> None:
+    converter = Converter(output_path=tmp_path / 'model')
+    # Split every layer across the threads
+    converter.kernelselector.parallel_min_ops = 1
+    assert converter.convert_model(modelgraph(quantization))
+    package = tmp_path / 'model'
+    assert 'parallel_for(' in generated_source(package)
+    assert_same_outputs(infer(package, 'WITH_THREADS'), infer(package), quantization)
+
+
+@pytest.mark.parametrize('parallel_min_ops', [1 << 17, 1])
+def test_branch_parallelism(tmp_path: Path, quantization: str, parallel_min_ops: int) -> None:
+    reference = generate(branch_model(quantization), tmp_path / 'reference')
+    converter = Converter(output_path=tmp_path / 'model', branch_parallelism=True)
+    # Layers that split their output run on the calling thread when they are a task of the graph
+    converter.kernelselector.parallel_min_ops = parallel_min_ops
+    assert converter.convert_model(branch_model(quantization))
+    package = tmp_path / 'model'
+    assert 'parallel_dag(' in generated_source(package)
+    assert_same_outputs(infer(package, 'WITH_THREADS'), infer(reference), quantization)
+    assert_same_outputs(infer(package, 'WITH_THREADS', 'ENTRY_R'), infer(reference), quantization)
+
+
+@pytest.mark.parametrize('pipeline_stages', [2, 3])
+def test_pipeline(tmp_path: Path, model: Callable[[str], ModelGraph], quantization: str, pipeline_stages: int) -> None:
+    reference = generate(model(quantization), tmp_path / 'reference')
+    package = generate(model(quantization), tmp_path / 'model', pipeline_stages=pipeline_stages)
+    assert 'PIPELINE_CONTEXTS' in generated_source(package)
+    assert_same_outputs(infer(package, 'WITH_THREADS', 'ENTRY_BATCH'), infer(reference), quantization)
+
+
+def single_layer_model(quantization: str) -> ModelGraph:
+    b = ModelBuilder((10,), seed=10)
+    b.dense(b.input, 4)
+    return b.quantize(quantization)
+
+
+def test_pipeline_single_layer(tmp_path: Path, quantization: str) -> None:
+    # A single layer cannot be split in two stages, cnn_batch() runs sequentially
+    reference = generate(single_layer_model(quantization), tmp_path / 'reference')
+    package = generate(single_layer_model(quantization), tmp_path / 'model', pipeline_stages=2)
+    assert 'PIPELINE_CONTEXTS' not in generated_source(package)
+    assert_same_outputs(infer(package, 'WITH_THREADS', 'ENTRY_BATCH'), infer(reference), quantization)
+
+
+@pytest.mark.parametrize('macs', [1, 500, 1 << 30])
+def test_cnn_step(tmp_path: Path, model: Callable[[str], ModelGraph], quantization: str, macs: int) -> None:
+    package = generate(model(quantization), tmp_path / 'model')
+    assert_same_outputs(infer(package, 'ENTRY_STEP', f'STEP_MACS={macs}UL'), infer(package), quantization)
+
+
+@pytest.mark.parametrize('hop', [2, 4])
+def test_cnn_push(tmp_path: Path, quantization: str, hop: int) -> None:
+    reference = generate(conv1d_model(quantization), tmp_path / 'reference')
+    package = generate(conv1d_model(quantization), tmp_path / 'model', stream_hop=hop)
+    assert_same_outputs(infer(package, f'WINDOW_HOP={hop}', 'ENTRY_PUSH'), infer(reference, f'WINDOW_HOP={hop}'), quantization)
+
+
+def test_cnn_update(tmp_path: Path, quantization: str) -> None:
+    reference = generate(conv2d_model(quantization), tmp_path / 'reference')
+    package = generate(conv2d_model(quantization), tmp_path / 'model', partial_update=True)
+    assert_same_outputs(infer(package, 'FRAMES', 'ENTRY_UPDATE'), infer(reference, 'FRAMES'), quantization)
+
+
+def run_gate(package: Path, threshold: float, shifts: list[float]) -> NDArray:
+    """Results of neuralNetworkInfer() with the change gate on inputs shifted by each value of shifts.
+
+    Columns: inference count, label, distance, gate hits, gate misses, label and distance computed without the gate.
+    """
+    include = ['-include', str(package / 'include' / 'defines.h'), '-I', str(package), '-I', str(package / 'include'),
+               '-I', str(LIBQUALIA_NEURALNETWORK)]
+    binary = package / 'gate'
+    subprocess.run(['gcc', '-std=gnu11', '-O2', '-Wall', *include, '-c', str(package / 'model.c'),  # noqa: S603, S607 Trusted compiler command
+                    '-o', str(package / 'model.o')], check=True)
+    subprocess.run(['gcc', '-std=gnu11', '-O2', '-Wall', *include, '-c', str(GATE_DRIVER),  # noqa: S603, S607 Trusted compiler command
+                    '-o', str(package / 'gate.o')], check=True)
+    subprocess.run(['g++', '-std=c++17', '-O2', '-Wall', *include, str(LIBQUALIA_NEURALNETWORK / 'NeuralNetwork.cpp'),  # noqa: S603, S607 Trusted compiler command
+                    str(package / 'model.o'), str(package / 'gate.o'), '-lm', '-o', str(binary)], check=True)
+    return parse_outputs(subprocess.run([str(binary), str(threshold), *map(str, shifts)],  # noqa: S603 Compiled test driver
+                                        capture_output=True, check=True).stdout)
+
+
+@pytest.mark.skipif(shutil.which('g++') is None, reason='Requires g++ for libqualia-neuralnetwork')
+@pytest.mark.parametrize(('threshold', 'shifts', 'hits'), [
+    # Drifts are compared against the input of the last computed inference, not of the previous inference
+    (0.25, [0, 0, 0.1, 0.2, 0.3, 0.3, 0.4, 1, 1, 0], [0, 1, 1, 1, 0, 1, 1, 0, 1, 0]),
+    (0, [0, 0, 0.5, 0.5, 0], [0, 1, 0, 1, 0]),
+    # Threshold beyond the range of the input number type, clamped
+    (1e30, [0, 5, -5, 0], [0, 1, 1, 1]),
+    # Disabled gate
+    (-1, [0, 0, 0.1], [0, 0, 0]),
+])
+def test_gate(tmp_path: Path,  # noqa: PLR0913, PLR0917
+              model: Callable[[str], ModelGraph],
+              quantization: str,
+              threshold: float,
+              shifts: list[float],
+              hits: list[int]) -> None:
+    package = generate(model(quantization), tmp_path / 'model')
+    results = run_gate(package, threshold, shifts)
+
+    np.testing.assert_array_equal(results[:, 0], np.arange(1, len(shifts) + 1))
+    if threshold < 0:
+        np.testing.assert_array_equal(results[:, 3:5], 0)
+    else:
+        np.testing.assert_array_equal(results[:, 3], np.cumsum(hits))
+        np.testing.assert_array_equal(results[:, 4], np.cumsum(np.logical_not(hits)))
+
+    for i, hit in enumerate(hits):
+        if hit:
+            # Result of the last computed inference
+            np.testing.assert_array_equal(results[i, 1:3], results[i - 1, 1:3])
+        else:
+            np.testing.assert_array_equal(results[i, 1:3], results[i, 5:7])
+
+
+@pytest.mark.parametrize('samples', [40, 25, 8])
+def test_cnn_sequence(tmp_path: Path, quantization: str, samples: int) -> None:
+    reference = generate(conv1d_model(quantization, samples=samples), tmp_path / 'reference')
+    package = generate(conv1d_model(quantization), tmp_path / 'model', variable_length=True)
+    assert_same_outputs(infer(package, f'SEQUENCE_SAMPLES={samples}', 'ENTRY_SEQUENCE'), infer(reference), quantization)
+
+
+@pytest.mark.parametrize('split_layer', ['conv1d_3', 'auto'])
+def test_split(tmp_path: Path, quantization: str, split_layer: str) -> None:
+    reference = generate(conv1d_model(quantization), tmp_path / 'reference')
+    package = generate(conv1d_model(quantization), tmp_path / 'model', split_layer=split_layer)
+    frames = run_driver(compile_driver(package / 'head', 'ENTRY_HEAD'))
+    outputs = parse_outputs(run_driver(compile_driver(package / 'tail', 'ENTRY_TAIL'), stdin=frames))
+    assert_same_outputs(outputs, infer(reference), quantization)
+
+
+@pytest.mark.parametrize('modelgraph', [conv1d_model, conv2d_model, branch_model])
+def test_activations_arena(tmp_path: Path,
+                           modelgraph: Callable[[str], ModelGraph],
+                           quantization: str,
+                           caplog: pytest.LogCaptureFixture) -> None:
+    reference = generate(modelgraph(quantization), tmp_path / 'reference', activations_arena=False)
+    assert '// Arena of' not in generated_source(reference)
+    with caplog.at_level(logging.INFO, logger='qualia_codegen_core.Allocator'):
+        package = generate(modelgraph(quantization), tmp_path / 'model')
+    # Arena only kept when smaller than the pools
+    assert ('// Arena of' in generated_source(package)) != ('keeping pools' in caplog.text)
+    assert_same_outputs(infer(package), infer(reference), quantization)
+    assert_same_outputs(infer(package, 'ENTRY_R'), infer(reference), quantization)
+
+
+@pytest.mark.parametrize('activations_arena', [True, False])
+def test_shared_activations(tmp_path: Path,
+                            quantization: str,
+                            activations_arena: bool,  # noqa: FBT001
+                            monkeypatch: pytest.MonkeyPatch,
+                            caplog: pytest.LogCaptureFixture) -> None:
+    with caplog.at_level(logging.INFO, logger='qualia_codegen_core.Allocator'):
+        package = generate(branch_model(quantization), tmp_path / 'model', activations_arena=activations_arena)
+    assert 'batchnorm1d_2 computed in place of conv1d_1' in caplog.text
+    assert 'slice_3 is a view of batchnorm1d_2' in caplog.text
+    assert 'conv1d_4, conv1d_5 computed in the output of concatenate_6' in caplog.text
+    assert 'add_9 computed in place of conv1d_7' in caplog.text
+    assert 'flatten_10 is a view of add_9' in caplog.text
+
+    # Each output computed in its own memory, Flatten still overwrites its input as before views
+    def overwrite_flatten_only(_self: Allocator,
+                               _modelgraph: ModelGraph,
+                               node: LayerNode,
+                               input_ai: list[Allocator.AllocInfo],
+                               _ancestors: dict[LayerNode, set[LayerNode]]) -> Allocator.AllocInfo | None:
+        return input_ai[0] if isinstance(node.layer, TFlattenLayer) else None
+
+    monkeypatch.setattr(Allocator, 'concatenations', lambda _self, _modelgraph: {})
+    monkeypatch.setattr(Allocator, 'overwrite_input', overwrite_flatten_only)
+    monkeypatch.setattr(Allocator, 'view_offset', lambda _self, _node: None)
+    reference = generate(branch_model(quantization), tmp_path / 'reference', activations_arena=activations_arena)
+
+    assert_same_outputs(infer(package), infer(reference), quantization)
+
+
+@pytest.mark.parametrize(('modelgraph', 'options', 'defines'), [
+    (conv1d_model, {'conv_engine': 'winograd'}, ()),
+    (conv2d_model, {'conv_engine': 'im2col'}, ()),
+    (branch_model, {'conv_engine': 'im2col', 'branch_parallelism': True}, ('WITH_THREADS',)),
+])
+def test_scratch_overlay(tmp_path: Path,  # noqa: PLR0913, PLR0917
+                         modelgraph: Callable[[str], ModelGraph],
+                         quantization: str,
+                         options: dict[str, Any],
+                         defines: tuple[str, ...],
+                         monkeypatch: pytest.MonkeyPatch) -> None:
+    package = generate(modelgraph(quantization), tmp_path / 'model', **options)
+
+    # Scratch buffer of each layer in its own union
+    def separate_scratch(_modelgraph: ModelGraph,
+                         nodes: list[LayerNode],
+                         concurrent_branches: bool = False) -> list[list[LayerNode]]:  # noqa: ARG001, FBT001, FBT002
+        return [[node] for node in nodes]
+
+    monkeypatch.setattr(Allocator, 'scratch_pools', staticmethod(separate_scratch))
+    reference = generate(modelgraph(quantization), tmp_path / 'reference', **options)
+
+    unions = 'the layers of this union never run at the same time'
+    assert 0 < generated_source(package).count(unions) < generated_source(reference).count(unions)
+    assert_same_outputs(infer(package, *defines), infer(reference, *defines), quantization)
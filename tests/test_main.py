@@ -0,0 +1,44 @@
+"""Check the arguments the qualia_codegen command line passes to the code generation."""
+
+from __future__ import annotations
+
+import sys
+from typing import Any
+
+import pytest
+
+import qualia_codegen_core.main as cli
+
+
+@pytest.mark.parametrize(('argv', 'args', 'options'), [
+    # Options after the positional arguments of a Keras model
+    (['m.h5', 'int8', 'r.txt', '--conv-engine', 'im2col', '--max-batch', '4', '--stream-hop', '2',
+      '--split-layer', 'auto'],
+     ('m.h5', 'int8', 'r.txt', ''),
+     {'conv_engine': 'im2col', 'max_batch': 4, 'stream_hop': 2, 'split_layer': 'auto'}),
+    (['--fuse-separable-conv', 'm.h5', '--branch-parallelism', '--partial-update',
+      '--variable-length'],
+     ('m.h5', 'float32', '', ''),
+     {'fuse_separable_conv': True, 'branch_parallelism': True, 'partial_update': True,
+      'variable_length': True}),
+    # PyTorch module arguments starting with - after --
+    (['m.pt', 'int16', 'r.txt', 'Net', '4', '--conv-scratch-size', '1024', '--pipeline-stages', '2',
+      '--no-activations-arena', '--',
+      '--hidden', '8'],
+     ('m.pt', 'int16', 'r.txt', 'Net', '4', '--hidden', '8'),
+     {'conv_scratch_size': 1024, 'pipeline_stages': 2, 'activations_arena': False}),
+])
+def test_main(monkeypatch: pytest.MonkeyPatch, argv: list[str], args: tuple[str, ...], options: dict[str, Any]) -> None:
+    calls: list[tuple[tuple[str, ...], dict[str, Any]]] = []
+
+    def qualia_codegen(*args: str, **converter_options: Any) -> str:  # noqa: ANN401 Converter keyword arguments of any type
+        calls.append((args, converter_options))
+        return 'model'
+
+    monkeypatch.setattr(cli, 'qualia_codegen', qualia_codegen)
+    monkeypatch.setattr(sys, 'argv', ['qualia_codegen', *argv])
+    assert cli.main() == 0
+
+    ((called_args, converter_options),) = calls
+    assert called_args == args
+    assert options.items() <= converter_options.items()